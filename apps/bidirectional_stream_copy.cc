@@ -2,27 +2,215 @@
 
 #include "byte_stream.hh"
 #include "eventloop.hh"
+#include "exception.hh"
 
+#include <array>
+#include <fcntl.h>
+#include <functional>
 #include <iostream>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 using namespace std;
 
-void bidirectional_stream_copy( Socket& socket, string_view peer_name )
+namespace {
+constexpr size_t buffer_size = 1048576;
+constexpr size_t read_batch = 65536; // don't read from a source until the stream has at least this much room
+
+// Can splice(2) move bytes to or from this descriptor? (pipes, sockets and regular files -- but not e.g. ttys)
+bool splice_capable( const FileDescriptor& fd )
+{
+  struct stat st {};
+  if ( fstat( fd.fd_num(), &st ) < 0 ) {
+    return false;
+  }
+  return S_ISFIFO( st.st_mode ) or S_ISSOCK( st.st_mode ) or S_ISREG( st.st_mode );
+}
+
+// How many bytes could be read from this descriptor right now? (pipes, sockets and regular files)
+size_t bytes_readable( const FileDescriptor& fd )
+{
+  int bytes = 0;
+  return ioctl( fd.fd_num(), FIONREAD, &bytes ) < 0 ? 0 : static_cast<size_t>( bytes ); // NOLINT(*-vararg)
+}
+
+// One direction of the zero-copy relay: source -> kernel pipe -> sink.
+// The pipe plays the role of the ByteStream in the copying relay.
+struct SpliceRelay
+{
+  FileDescriptor pipe_read;
+  FileDescriptor pipe_write;
+  size_t capacity;
+  size_t buffered {};
+  bool pipe_full {}; // the pipe ran out of slots before reaching `capacity` bytes
+  bool source_eof {};
+  bool finished {};
+
+  SpliceRelay( pair<FileDescriptor, FileDescriptor> pipe_ends, size_t requested_capacity )
+    : pipe_read( move( pipe_ends.first ) ), pipe_write( move( pipe_ends.second ) ), capacity( requested_capacity )
+  {
+    // Try to grow the pipe to match the copying relay's buffer, but settle for whatever the kernel allows.
+    const int actual = fcntl( pipe_write.fd_num(), F_SETPIPE_SZ, static_cast<int>( capacity ) ); // NOLINT(*-vararg)
+    capacity = actual > 0 ? static_cast<size_t>( actual )
+                          : CheckSystemCall( "fcntl", fcntl( pipe_write.fd_num(), F_GETPIPE_SZ ) ); // NOLINT(*-vararg)
+  }
+
+  static pair<FileDescriptor, FileDescriptor> make_pipe()
+  {
+    array<int, 2> fds {};
+    CheckSystemCall( "pipe2", ::pipe2( fds.data(), O_NONBLOCK | O_CLOEXEC ) );
+    return { FileDescriptor { fds[0] }, FileDescriptor { fds[1] } };
+  }
+
+  explicit SpliceRelay( size_t requested_capacity ) : SpliceRelay( make_pipe(), requested_capacity ) {}
+
+  // Move bytes with splice(2), noting (rather than throwing) if the kernel refuses one of the descriptors.
+  static size_t splice( FileDescriptor& from, FileDescriptor& to, size_t len, bool& unsupported )
+  {
+    try {
+      return from.splice( to, len );
+    } catch ( const unix_error& e ) {
+      if ( e.error_code() != EINVAL ) {
+        throw;
+      }
+      unsupported = true;
+      return 0;
+    }
+  }
+
+  // Carry this direction over to the copying relay: the bytes still in the pipe go into `stream` first.
+  void hand_over( ByteStream& stream, bool& sink_finished )
+  {
+    Writer& writer = stream.writer();
+    while ( buffered ) {
+      const size_t moved = pipe_read.read( writer.reserve( buffered ) );
+      if ( moved == 0 ) {
+        throw runtime_error( "SpliceRelay: pipe held fewer bytes than expected" );
+      }
+      writer.commit( moved );
+      buffered -= moved;
+    }
+    if ( source_eof ) {
+      writer.close();
+    }
+    sink_finished = finished;
+  }
+};
+
+void add_splice_rules( EventLoop& eventloop,
+                       SpliceRelay& relay,
+                       FileDescriptor& source,
+                       FileDescriptor& sink,
+                       const string& name,
+                       bool& error,
+                       bool& unsupported,
+                       const function<void()>& finish )
 {
-  constexpr size_t buffer_size = 1048576;
+  // read from the source into the pipe
+  eventloop.add_rule(
+    "splice " + name + " into pipe",
+    source,
+    Direction::In,
+    [&] {
+      const size_t moved
+        = SpliceRelay::splice( source, relay.pipe_write, relay.capacity - relay.buffered, unsupported );
+      relay.buffered += moved;
+      // Nothing moved from a source with bytes to read means the pipe is out of slots. (A nonblocking source
+      // with nothing to read also moves nothing, but then the pipe still has room and poll() will wait.)
+      relay.pipe_full = moved == 0 and relay.buffered > 0 and not source.eof() and bytes_readable( source ) > 0;
+      relay.source_eof = source.eof();
+    },
+    [&] {
+      return not error and not unsupported and not relay.source_eof and not relay.pipe_full
+             and relay.buffered < relay.capacity;
+    },
+    [&] { relay.source_eof = true; },
+    [&, name] {
+      cerr << "DEBUG: " << name << " had error from source.\n";
+      error = true;
+    } );
 
+  // write from the pipe into the sink
+  eventloop.add_rule(
+    "splice pipe into " + name,
+    sink,
+    Direction::Out,
+    [&, finish] {
+      if ( relay.buffered ) {
+        const size_t moved = SpliceRelay::splice( relay.pipe_read, sink, relay.buffered, unsupported );
+        relay.buffered -= moved;
+        if ( moved ) {
+          relay.pipe_full = false;
+        }
+      }
+      if ( relay.source_eof and relay.buffered == 0 ) {
+        relay.finished = true;
+        finish();
+      }
+    },
+    [&] {
+      return not error and not unsupported and ( relay.buffered or ( relay.source_eof and not relay.finished ) );
+    },
+    [&] { relay.source_eof = true; },
+    [&, name] {
+      cerr << "DEBUG: " << name << " had error from destination.\n";
+      error = true;
+    } );
+}
+
+// Relay both directions inside the kernel with splice(2), never copying the bytes through user space.
+// Returns false, leaving the rest to the copying relay, if the kernel can't splice one of the descriptors
+// after all (e.g. EINVAL for an O_APPEND file).
+bool splice_stream_copy( Socket& socket,
+                         FileDescriptor& input,
+                         FileDescriptor& output,
+                         string_view peer_name,
+                         SpliceRelay& outbound,
+                         SpliceRelay& inbound )
+{
+  EventLoop eventloop {};
+  bool error {};
+  bool unsupported {};
+
+  add_splice_rules( eventloop, outbound, input, socket, "outbound stream", error, unsupported, [&] {
+    socket.shutdown( SHUT_WR );
+    cerr << "DEBUG: Outbound stream to " << peer_name << " finished.\n";
+  } );
+
+  add_splice_rules( eventloop, inbound, socket, output, "inbound stream", error, unsupported, [&] {
+    output.close();
+    cerr << "DEBUG: Inbound stream from " << peer_name << " finished.\n";
+  } );
+
+  // loop until completion
+  while ( true ) {
+    if ( EventLoop::Result::Exit == eventloop.wait_next_event( -1 ) ) {
+      return not unsupported;
+    }
+  }
+}
+
+// Relay both directions through user-space ByteStreams (works with any kind of file descriptor),
+// picking up where a splice relay left off if given one.
+void byte_stream_copy( Socket& socket,
+                       FileDescriptor& input,
+                       FileDescriptor& output,
+                       string_view peer_name,
+                       SpliceRelay* outbound_relay = nullptr,
+                       SpliceRelay* inbound_relay = nullptr )
+{
   EventLoop eventloop {};
-  FileDescriptor input { STDIN_FILENO };
-  FileDescriptor output { STDOUT_FILENO };
   ByteStream outbound { buffer_size };
   ByteStream inbound { buffer_size };
   bool outbound_shutdown { false };
   bool inbound_shutdown { false };
-
-  socket.set_blocking( false );
-  input.set_blocking( false );
-  output.set_blocking( false );
+  outbound.set_watermarks( buffer_size - read_batch, 1 );
+  inbound.set_watermarks( buffer_size - read_batch, 1 );
+  if ( outbound_relay and inbound_relay ) {
+    outbound_relay->hand_over( outbound, outbound_shutdown );
+    inbound_relay->hand_over( inbound, inbound_shutdown );
+  }
 
   // rule 1: read from stdin into outbound byte stream
   eventloop.add_rule(
@@ -30,16 +218,14 @@ void bidirectional_stream_copy( Socket& socket, string_view peer_name )
     input,
     Direction::In,
     [&] {
-      string data;
-      data.resize( outbound.writer().available_capacity() );
-      input.read( data );
-      outbound.writer().push( move( data ) );
+      Writer& writer = outbound.writer();
+      writer.commit( input.read( writer.reserve( writer.available_capacity() ) ) );
       if ( input.eof() ) {
         outbound.writer().close();
       }
     },
     [&] {
-      return !outbound.has_error() and !inbound.has_error() and ( outbound.writer().available_capacity() > 0 )
+      return !outbound.has_error() and !inbound.has_error() and outbound.writer().writable()
              and !outbound.writer().is_closed();
     },
     [&] { outbound.writer().close(); },
@@ -56,7 +242,7 @@ void bidirectional_stream_copy( Socket& socket, string_view peer_name )
     Direction::Out,
     [&] {
       if ( outbound.reader().bytes_buffered() ) {
-        outbound.reader().pop( socket.write( outbound.reader().peek() ) );
+        outbound.reader().pop( socket.write( outbound.reader().peek_iov() ) );
       }
       if ( outbound.reader().is_finished() ) {
         socket.shutdown( SHUT_WR );
@@ -80,16 +266,14 @@ void bidirectional_stream_copy( Socket& socket, string_view peer_name )
     socket,
     Direction::In,
     [&] {
-      string data;
-      data.resize( inbound.writer().available_capacity() );
-      socket.read( data );
-      inbound.writer().push( move( data ) );
+      Writer& writer = inbound.writer();
+      writer.commit( socket.read( writer.reserve( writer.available_capacity() ) ) );
       if ( socket.eof() ) {
         inbound.writer().close();
       }
     },
     [&] {
-      return !inbound.has_error() and !outbound.has_error() and ( inbound.writer().available_capacity() > 0 )
+      return !inbound.has_error() and !outbound.has_error() and inbound.writer().writable()
              and !inbound.writer().is_closed();
     },
     [&] { inbound.writer().close(); },
@@ -106,7 +290,7 @@ void bidirectional_stream_copy( Socket& socket, string_view peer_name )
     Direction::Out,
     [&] {
       if ( inbound.reader().bytes_buffered() ) {
-        inbound.reader().pop( output.write( inbound.reader().peek() ) );
+        inbound.reader().pop( output.write( inbound.reader().peek_iov() ) );
       }
       if ( inbound.reader().is_finished() ) {
         output.close();
@@ -132,3 +316,27 @@ void bidirectional_stream_copy( Socket& socket, string_view peer_name )
     }
   }
 }
+} // namespace
+
+void bidirectional_stream_copy( Socket& socket, string_view peer_name )
+{
+  FileDescriptor input { STDIN_FILENO };
+  FileDescriptor output { STDOUT_FILENO };
+
+  socket.set_blocking( false );
+  input.set_blocking( false );
+  output.set_blocking( false );
+
+  // When both ends are kernel objects that splice(2) understands, skip the user-space copy entirely.
+  if ( splice_capable( input ) and splice_capable( output ) ) {
+    cerr << "DEBUG: Relaying with splice(2).\n";
+    SpliceRelay outbound { buffer_size };
+    SpliceRelay inbound { buffer_size };
+    if ( not splice_stream_copy( socket, input, output, peer_name, outbound, inbound ) ) {
+      cerr << "DEBUG: splice(2) unsupported here, relaying through user space.\n";
+      byte_stream_copy( socket, input, output, peer_name, &outbound, &inbound );
+    }
+  } else {
+    byte_stream_copy( socket, input, output, peer_name );
+  }
+}
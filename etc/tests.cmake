@@ -23,6 +23,11 @@ ttest(byte_stream_one_write)
 ttest(byte_stream_two_writes)
 ttest(byte_stream_many_writes)
 ttest(byte_stream_stress_test)
+ttest(byte_stream_watermarks)
+ttest(byte_stream_retain)
+ttest(byte_stream_reserve)
+ttest(byte_stream_mapped)
+ttest(byte_stream_concurrent)
 
 ttest(reassembler_single)
 ttest(reassembler_cap)
@@ -31,6 +36,8 @@ ttest(reassembler_dup)
 ttest(reassembler_holes)
 ttest(reassembler_overlapping)
 ttest(reassembler_win)
+ttest(reassembler_sack)
+ttest(reassembler_budget)
 
 ttest(wrapping_integers_cmp)
 ttest(wrapping_integers_wrap)
@@ -42,6 +49,8 @@ ttest(recv_connect)
 ttest(recv_transmit)
 ttest(recv_window)
 ttest(recv_reorder)
+ttest(recv_sack)
+ttest(recv_window_scale)
 ttest(recv_reorder_more)
 ttest(recv_close)
 ttest(recv_special)
@@ -53,11 +62,23 @@ ttest(send_ack)
 ttest(send_close)
 ttest(send_retx)
 ttest(send_extra)
+ttest(send_congestion)
+ttest(send_rto)
+ttest(send_fast_retx)
+ttest(send_sack)
+ttest(send_repacketize)
+ttest(send_pacing)
+ttest(send_nagle)
+ttest(send_mss)
 
 ttest(net_interface)
 
 ttest(router)
 
+ttest(chunk_pool)
+
+ttest(stream_copy_relay)
+
 ttest(no_skip)
 
 add_custom_target (check0 COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --stop-on-failure --timeout 15 -R 'webget|^byte_stream_|^no_skip')
@@ -94,3 +115,16 @@ set_tests_properties(${compile_name_opt} PROPERTIES FIXTURES_SETUP compile_opt)
 
 stest(byte_stream_speed_test)
 stest(reassembler_speed_test)
+
+add_test(NAME reassembler_bench_quick COMMAND reassembler_bench --quick --repeat=1)
+set_property(TEST reassembler_bench_quick PROPERTY FIXTURES_REQUIRED compile_opt)
+
+add_test(NAME send_path_bench_quick COMMAND send_path_bench --quick --repeat=1)
+set_property(TEST send_path_bench_quick PROPERTY FIXTURES_REQUIRED compile_opt)
+
+add_custom_target (bench
+  COMMAND "${CMAKE_BINARY_DIR}/tests/byte_stream_bench" --format=json > "${CMAKE_BINARY_DIR}/byte_stream_bench.json"
+  COMMAND "${CMAKE_BINARY_DIR}/tests/reassembler_bench" --format=json > "${CMAKE_BINARY_DIR}/reassembler_bench.json"
+  COMMAND "${CMAKE_BINARY_DIR}/tests/send_path_bench" --format=json > "${CMAKE_BINARY_DIR}/send_path_bench.json"
+  DEPENDS byte_stream_bench reassembler_bench send_path_bench
+  COMMENT "Writing ${CMAKE_BINARY_DIR}/byte_stream_bench.json, reassembler_bench.json and send_path_bench.json")
@@ -1,24 +1,127 @@
 #include "byte_stream.hh"
 #include "debug.hh"
 
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
 using namespace std;
 
-ByteStream::ByteStream( uint64_t capacity ) : capacity_( capacity ) {}
+namespace {
+constexpr uint64_t kMinBufferSize = 4096;
+constexpr uint64_t kDiscardBatch = 1024 * 1024; // hand popped pages back to the kernel at least this many at once
+} // namespace
+
+ByteStream::ByteStream( uint64_t capacity ) : capacity_( capacity )
+{
+  if ( capacity_ >= MAPPED_BUFFER_THRESHOLD ) {
+    mapped_buffer = MappedRingBuffer { capacity_ };
+  }
+}
+
+void ByteStream::set_watermarks( uint64_t low, uint64_t high )
+{
+  low_watermark = low;
+  high_watermark = max( high, uint64_t { 1 } );
+}
+
+// Reallocate the ring so the stored (retained, then buffered) bytes start at offset 0 and there is room for
+// `min_size` bytes.
+void ByteStream::grow_buffer( uint64_t min_size )
+{
+  const uint64_t new_size = min( capacity_, max( { min_size, 2 * buffer.size(), kMinBufferSize } ) );
+  string grown( new_size, '\0' );
+
+  const uint64_t start = buffer.empty() ? 0 : ( buffer_head + buffer.size() - bytesretained ) % buffer.size();
+  const uint64_t first = min( stored(), buffer.size() - start );
+  memcpy( grown.data(), buffer.data() + start, first );
+  memcpy( grown.data() + first, buffer.data(), stored() - first );
+
+  buffer = std::move( grown );
+  buffer_head = bytesretained;
+  memory_charge.set( ring_footprint() );
+}
+
+// Punch out the whole pages of released bytes, except those the Writer has already wrapped around onto
+// (or reserved): by the time a batch is flushed, those may hold new, unread bytes.
+void ByteStream::discard_released()
+{
+  const uint64_t released = bytesreceived - bytesretained;
+  if ( released - buffer_discarded < kDiscardBatch and stored() != 0 ) {
+    return;
+  }
+
+  const uint64_t page = MappedRingBuffer::page_size();
+  const uint64_t written = max( bytessent, buffer_reserved );
+  const uint64_t reusable = written > mapped_buffer.size() ? written - mapped_buffer.size() : 0;
+  const uint64_t begin = ( max( buffer_discarded, reusable ) + page - 1 ) / page * page;
+  const uint64_t end = released / page * page;
+  if ( begin < end ) {
+    mapped_buffer.discard( begin % mapped_buffer.size(), end - begin );
+  }
+  buffer_discarded = max( buffer_discarded, end );
+}
+
+// The heap ring stays allocated once the stream drains, ready for the next push, unless the budget is short.
+void ByteStream::update_charge()
+{
+  const shared_ptr<MemoryBudget>& budget = memory_charge.budget();
+  if ( mapped_buffer.size() == 0 and stored() == 0 and budget and budget->state() != MemoryBudget::State::Normal ) {
+    buffer = string {};
+    buffer_head = 0;
+  }
+  memory_charge.set( ring_footprint() );
+}
+
+// The heap ring's allocation, or the mapped ring's pages written since the last discard (at most all of them).
+uint64_t ByteStream::ring_footprint() const
+{
+  if ( mapped_buffer.size() == 0 ) {
+    return buffer.size();
+  }
+  return min( mapped_buffer.size(), bytessent - buffer_discarded );
+}
 
 // Push data to stream, but only as much as available capacity allows.
 void Writer::push( string data )
 {
-  uint64_t available_bytes = available_capacity();
-  bytesready = data.size();
-  if ( bytesready == 0 || available_bytes == 0 )
-    return;
+  string_view remaining { data };
+  while ( not remaining.empty() ) {
+    const span<char> space = reserve( remaining.size() );
+    if ( space.empty() )
+      return;
+    memcpy( space.data(), remaining.data(), space.size() );
+    commit( space.size() );
+    remaining.remove_prefix( space.size() );
+  }
+}
+
+// Writable space for up to `len` more bytes, stopping at the end of the ring.
+span<char> Writer::reserve( uint64_t len )
+{
+  len = min( len, available_capacity() );
+  if ( len == 0 )
+    return {};
+
+  if ( ring_size() < stored() + len )
+    grow_buffer( stored() + len );
+
+  const uint64_t tail = ( buffer_head + bytesinbuffer ) % ring_size();
+  len = min( len, ring_run( tail ) );
+  buffer_reserved = max( buffer_reserved, bytessent + len );
+  return { ring() + tail, len };
+}
+
+// Make `len` bytes written into the space returned by reserve() part of the stream.
+void Writer::commit( uint64_t len )
+{
+  if ( len > available_capacity() or stored() + len > ring_size() ) {
+    throw runtime_error( "Writer::commit() exceeds reserved space" );
+  }
 
-  available_bytes = min( available_bytes, bytesready );
-  if ( available_bytes < bytesready )
-    data = data.substr( 0, available_bytes );
-  buffer.emplace_back( std::move( data ) );
-  bytessent += available_bytes;
-  bytesinbuffer += available_bytes;
+  bytessent += len;
+  bytesinbuffer += len;
+  memory_charge.set( ring_footprint() );
 }
 
 // Signal that the stream has reached its ending. Nothing more will be written.
@@ -36,8 +139,7 @@ bool Writer::is_closed() const
 // How many bytes can be pushed to the stream right now?
 uint64_t Writer::available_capacity() const
 {
-
-  return capacity_ - bytesinbuffer;
+  return capacity_ - stored();
 }
 
 // Total number of bytes cumulatively pushed to the stream
@@ -46,36 +148,92 @@ uint64_t Writer::bytes_pushed() const
   return bytessent;
 }
 
+// Is there room and has the stream drained to the low watermark?
+bool Writer::writable() const
+{
+  return has_error() or ( available_capacity() > 0 and bytesinbuffer <= low_watermark );
+}
+
 // Peek at the next bytes in the buffer -- ideally as many as possible.
 // It's not required to return a string_view of the *whole* buffer, but
 // if the peeked string_view is only one byte at a time, it will probably force
 // the caller to do a lot of extra work.
+// Returns every buffered byte unless the ring wraps, in which case the bytes up to the wrap point.
 string_view Reader::peek() const
 {
   if ( bytesinbuffer == 0 )
     return {};
-  return buffer.front();
+  return { ring() + buffer_head, min( bytesinbuffer, ring_run( buffer_head ) ) };
+}
+
+// Peek at the buffered bytes as up to two views: the run before the ring's wrap point and the run after it.
+span<const string_view> Reader::peek_iov( size_t max_segments ) const
+{
+  max_segments = min( max_segments, peek_segments.size() );
+  size_t count = 0;
+  uint64_t offset = buffer_head;
+  uint64_t remaining = bytesinbuffer;
+  while ( remaining and count < max_segments ) {
+    const uint64_t len = min( remaining, ring_run( offset ) );
+    peek_segments.at( count++ ) = { ring() + offset, len };
+    remaining -= len;
+    offset = 0;
+  }
+  return { peek_segments.data(), count };
 }
 
 // Remove `len` bytes from the buffer.
 void Reader::pop( uint64_t len )
 {
-  uint64_t available_bytes = min( len, bytes_buffered() );
-  if ( available_bytes == 0 )
+  len = min( len, bytesinbuffer );
+  if ( len == 0 )
     return;
-  bytesreceived += available_bytes;
-  uint64_t tmp, sz;
-  while ( available_bytes ) {
-    sz = buffer.front().size();
-    if ( sz > available_bytes ) {
-      buffer.front() = buffer.front().substr( available_bytes );
-    } else {
-      buffer.pop_front();
-    }
-    tmp = min( available_bytes, sz );
-    available_bytes -= tmp;
-    bytesinbuffer -= tmp;
+
+  bytesreceived += len;
+  bytesinbuffer -= len;
+  bytesretained += retain_popped ? len : 0;
+
+  if ( mapped_buffer.size() == 0 ) {
+    // An empty ring restarts at offset 0, so the next peek is contiguous for as long as possible.
+    buffer_head = stored() ? ( buffer_head + len ) % buffer.size() : 0;
+  } else {
+    buffer_head = ( buffer_head + len ) % mapped_buffer.size();
+    discard_released();
+  }
+  update_charge();
+}
+
+// Views of `len` retained bytes, starting `offset` bytes after the oldest: up to two, split at the wrap point.
+span<const string_view> Reader::peek_retained( uint64_t offset, uint64_t len ) const
+{
+  offset = min( offset, bytesretained );
+  len = min( len, bytesretained - offset );
+  size_t count = 0;
+  uint64_t position = len ? ( buffer_head + ring_size() - bytesretained + offset ) % ring_size() : 0;
+  while ( len ) {
+    const uint64_t run = min( len, ring_run( position ) );
+    peek_segments.at( count++ ) = { ring() + position, run };
+    len -= run;
+    position = 0;
+  }
+  return { peek_segments.data(), count };
+}
+
+// Free the `len` oldest retained bytes.
+void Reader::release( uint64_t len )
+{
+  len = min( len, bytesretained );
+  if ( len == 0 )
+    return;
+
+  bytesretained -= len;
+
+  if ( mapped_buffer.size() == 0 ) {
+    buffer_head = stored() ? buffer_head : 0;
+  } else {
+    discard_released();
   }
+  update_charge();
 }
 
 // Is the stream finished (closed and fully popped)?
@@ -95,3 +253,9 @@ uint64_t Reader::bytes_popped() const
 {
   return bytesreceived;
 }
+
+// Has the high watermark been reached (or the stream closed or errored)?
+bool Reader::readable() const
+{
+  return has_error() or writer().is_closed() or bytesinbuffer >= high_watermark;
+}
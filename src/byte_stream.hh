@@ -1,7 +1,13 @@
 #pragma once
 
+#include "mapped_ring_buffer.hh"
+#include "memory_budget.hh"
+
+#include <array>
 #include <cstdint>
-#include <deque>
+#include <limits>
+#include <memory>
+#include <span>
 #include <string>
 #include <string_view>
 
@@ -13,6 +19,9 @@ class ByteStream
 public:
   explicit ByteStream( uint64_t capacity );
 
+  // Streams at least this large keep their bytes in a MappedRingBuffer instead of on the heap.
+  static constexpr uint64_t MAPPED_BUFFER_THRESHOLD = 8 * 1024 * 1024;
+
   // Helper functions (provided) to access the ByteStream's Reader and Writer interfaces
   Reader& reader();
   const Reader& reader() const;
@@ -22,13 +31,58 @@ public:
   void set_error() { error_ = true; };       // Signal that the stream suffered an error.
   bool has_error() const { return error_; }; // Has the stream had an error?
 
+  // Watermarks (cf. SO_SNDLOWAT and SO_RCVLOWAT): the Writer is writable() only once the stream has drained to
+  // `low` buffered bytes or fewer, and the Reader is readable() only once `high` bytes are buffered (or the
+  // stream is closed). The defaults make both sides ready for a single byte.
+  void set_watermarks( uint64_t low, uint64_t high );
+
+  // Charge the memory this stream's ring takes up to `budget` (shared with other streams and connections).
+  // A Reassembler writing into the stream charges its pending bytes to the same budget.
+  void set_memory_budget( const std::shared_ptr<MemoryBudget>& budget ) { memory_charge.attach( budget ); }
+  const std::shared_ptr<MemoryBudget>& memory_budget() const { return memory_charge.budget(); }
+
+  // Keep popped bytes in the stream until Reader::release() (cf. a socket's send buffer holding unacknowledged
+  // data), so the Reader can look at them again with Reader::peek_retained(). Retained bytes count against the
+  // Writer's capacity, and keep the ring (and its charge to the memory budget) from shrinking.
+  void set_retain_popped( bool retain ) { retain_popped = retain; }
+
 protected:
   // Please add any additional state to the ByteStream here, and not to the Writer and Reader interfaces.
   uint64_t capacity_;
   bool error_ {};
   bool close_status {};
-  uint64_t bytessent {}, bytesready {}, bytesinbuffer {}, bytesreceived {};
-  std::deque<std::string> buffer {};
+  uint64_t bytessent {}, bytesinbuffer {}, bytesreceived {};
+  bool retain_popped {};
+  uint64_t bytesretained {}; // popped but not yet released; they precede `buffer_head` in the ring
+
+  // Buffered bytes live in a ring: `buffer_head` is the offset of the next unpopped byte, and the ring
+  // is grown on demand (never past `capacity_`) so small streams with a large capacity stay small.
+  // Very large streams instead use a fixed, mirrored memfd mapping whose pages are returned to the
+  // kernel as they are released (`buffer_discarded` counts the released bytes already handed back, and
+  // `buffer_reserved` is the stream position just past the last byte handed out by Writer::reserve()).
+  std::string buffer {};
+  MappedRingBuffer mapped_buffer {};
+  uint64_t buffer_head {};
+  uint64_t buffer_discarded {};
+  uint64_t buffer_reserved {};
+  mutable std::array<std::string_view, 2> peek_segments {}; // backing storage for Reader::peek_iov()
+
+  uint64_t low_watermark { std::numeric_limits<uint64_t>::max() };
+  uint64_t high_watermark { 1 };
+  MemoryBudget::Charge memory_charge {}; // ring_footprint(), charged to the memory budget (if any)
+
+  void grow_buffer( uint64_t min_size ); // Resize the ring to hold at least `min_size` bytes.
+  void discard_released();               // Hand the mapped ring's released pages back to the kernel.
+  void update_charge();                  // After a pop or release: free an empty ring if memory is short.
+  uint64_t ring_footprint() const;       // Bytes of memory the ring takes up
+  uint64_t stored() const { return bytesretained + bytesinbuffer; } // bytes the ring has to hold
+
+  char* ring() { return mapped_buffer.size() ? mapped_buffer.data() : buffer.data(); }
+  const char* ring() const { return mapped_buffer.size() ? mapped_buffer.data() : buffer.data(); }
+  uint64_t ring_size() const { return mapped_buffer.size() ? mapped_buffer.size() : buffer.size(); }
+
+  // How many bytes starting at ring offset `offset` are contiguous in memory? (The mapped ring never wraps.)
+  uint64_t ring_run( uint64_t offset ) const { return mapped_buffer.size() ? ring_size() : ring_size() - offset; }
 };
 
 class Writer : public ByteStream
@@ -37,20 +91,37 @@ public:
   void push( std::string data ); // Push data to stream, but only as much as available capacity allows.
   void close();                  // Signal that the stream has reached its ending. Nothing more will be written.
 
+  // Zero-copy alternative to push(): reserve() returns writable space inside the stream (at most `len` bytes,
+  // possibly fewer at the ring's wrap point), and commit() makes the first `len` bytes written there readable.
+  std::span<char> reserve( uint64_t len );
+  void commit( uint64_t len );
+
   bool is_closed() const;              // Has the stream been closed?
   uint64_t available_capacity() const; // How many bytes can be pushed to the stream right now?
   uint64_t bytes_pushed() const;       // Total number of bytes cumulatively pushed to the stream
+  bool writable() const;               // Is there room and has the stream drained to the low watermark?
 };
 
 class Reader : public ByteStream
 {
 public:
   std::string_view peek() const; // Peek at the next bytes in the buffer -- ideally as many as possible.
+
+  // Peek at every buffered byte as (at most `max_segments`) non-empty views, e.g. for a single writev().
+  // The views are valid until the next call to a non-const method or to peek_iov().
+  std::span<const std::string_view> peek_iov( size_t max_segments = 2 ) const;
   void pop( uint64_t len );      // Remove `len` bytes from the buffer.
 
+  // With set_retain_popped(): the bytes popped and not yet released (the oldest first), and release() to
+  // free the `len` oldest of them. Views are valid like those from peek_iov().
+  uint64_t bytes_retained() const { return bytesretained; }
+  std::span<const std::string_view> peek_retained( uint64_t offset, uint64_t len ) const;
+  void release( uint64_t len );
+
   bool is_finished() const;        // Is the stream finished (closed and fully popped)?
   uint64_t bytes_buffered() const; // Number of bytes currently buffered (pushed and not popped)
   uint64_t bytes_popped() const;   // Total number of bytes cumulatively popped from stream
+  bool readable() const;           // Has the high watermark been reached (or the stream closed or errored)?
 };
 
 /*
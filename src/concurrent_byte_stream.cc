@@ -0,0 +1,175 @@
+#include "concurrent_byte_stream.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+ConcurrentByteStream::ConcurrentByteStream( uint64_t capacity, bool with_wakeups )
+  : capacity_( capacity ), buffer_( make_unique_for_overwrite<char[]>( capacity ) )
+{
+  if ( capacity_ == 0 ) {
+    throw runtime_error( "ConcurrentByteStream requires a nonzero capacity" );
+  }
+  if ( with_wakeups ) {
+    wakeups_.emplace();
+  }
+}
+
+void ConcurrentByteStream::set_error()
+{
+  error_.store( true, memory_order_release );
+  notify( 0 );
+  notify( 1 );
+}
+
+void ConcurrentByteStream::notify( size_t which )
+{
+  if ( wakeups_.has_value() ) {
+    wakeups_->at( which ).notify();
+  }
+}
+
+// Writer side: owns `pushed_`, observes `popped_`.
+
+void ConcurrentWriter::push( string data )
+{
+  string_view remaining { data };
+  while ( not remaining.empty() ) {
+    const span<char> space = reserve( remaining.size() );
+    if ( space.empty() ) {
+      return;
+    }
+    memcpy( space.data(), remaining.data(), space.size() );
+    commit( space.size() );
+    remaining.remove_prefix( space.size() );
+  }
+}
+
+span<char> ConcurrentWriter::reserve( uint64_t len )
+{
+  // Out of space after this: ask the reader for a wakeup, then look again (pairs with the fence in pop()), so
+  // either we see the bytes it popped meanwhile or it sees the flag.
+  if ( len >= available_capacity() and wakeups_.has_value() ) {
+    writer_waiting_.store( true, memory_order_relaxed );
+    atomic_thread_fence( memory_order_seq_cst );
+  }
+
+  len = min( len, available_capacity() );
+  const uint64_t tail = pushed_.load( memory_order_relaxed ) % capacity_;
+  return { buffer_.get() + tail, min( len, capacity_ - tail ) };
+}
+
+void ConcurrentWriter::commit( uint64_t len )
+{
+  if ( len > available_capacity() ) {
+    throw runtime_error( "ConcurrentWriter::commit() exceeds reserved space" );
+  }
+  if ( len == 0 ) {
+    return;
+  }
+
+  const uint64_t pushed = pushed_.load( memory_order_relaxed );
+  pushed_.store( pushed + len, memory_order_release );
+
+  // Pairs with the fence in pop(): either the reader sees these bytes before it sleeps,
+  // or we see that it had drained the stream and wake it up.
+  if ( wakeups_.has_value() ) {
+    atomic_thread_fence( memory_order_seq_cst );
+    if ( popped_.load( memory_order_relaxed ) == pushed ) {
+      notify( 0 );
+    }
+  }
+}
+
+void ConcurrentWriter::close()
+{
+  closed_.store( true, memory_order_release );
+  notify( 0 );
+}
+
+bool ConcurrentWriter::is_closed() const
+{
+  return closed_.load( memory_order_acquire );
+}
+
+uint64_t ConcurrentWriter::available_capacity() const
+{
+  return capacity_ - ( pushed_.load( memory_order_relaxed ) - popped_.load( memory_order_acquire ) );
+}
+
+uint64_t ConcurrentWriter::bytes_pushed() const
+{
+  return pushed_.load( memory_order_relaxed );
+}
+
+// Reader side: owns `popped_`, observes `pushed_`.
+
+string_view ConcurrentReader::peek() const
+{
+  const uint64_t popped = popped_.load( memory_order_relaxed );
+  const uint64_t buffered = pushed_.load( memory_order_acquire ) - popped;
+  const uint64_t head = popped % capacity_;
+  return { buffer_.get() + head, min( buffered, capacity_ - head ) };
+}
+
+void ConcurrentReader::pop( uint64_t len )
+{
+  len = min( len, bytes_buffered() );
+  if ( len == 0 ) {
+    return;
+  }
+
+  const uint64_t popped = popped_.load( memory_order_relaxed );
+  popped_.store( popped + len, memory_order_release );
+
+  if ( wakeups_.has_value() ) {
+    atomic_thread_fence( memory_order_seq_cst );
+    if ( writer_waiting_.exchange( false, memory_order_relaxed ) ) {
+      notify( 1 );
+    }
+  }
+}
+
+bool ConcurrentReader::is_finished() const
+{
+  // Load `closed_` first: once it is seen, every push that preceded close() is visible too.
+  return closed_.load( memory_order_acquire ) and bytes_buffered() == 0;
+}
+
+uint64_t ConcurrentReader::bytes_buffered() const
+{
+  return pushed_.load( memory_order_acquire ) - popped_.load( memory_order_relaxed );
+}
+
+uint64_t ConcurrentReader::bytes_popped() const
+{
+  return popped_.load( memory_order_relaxed );
+}
+
+ConcurrentReader& ConcurrentByteStream::reader()
+{
+  static_assert( sizeof( ConcurrentReader ) == sizeof( ConcurrentByteStream ),
+                 "Please add member variables to the ConcurrentByteStream base, not the ConcurrentReader." );
+
+  return static_cast<ConcurrentReader&>( *this ); // NOLINT(*-downcast)
+}
+
+const ConcurrentReader& ConcurrentByteStream::reader() const
+{
+  return static_cast<const ConcurrentReader&>( *this ); // NOLINT(*-downcast)
+}
+
+ConcurrentWriter& ConcurrentByteStream::writer()
+{
+  static_assert( sizeof( ConcurrentWriter ) == sizeof( ConcurrentByteStream ),
+                 "Please add member variables to the ConcurrentByteStream base, not the ConcurrentWriter." );
+
+  return static_cast<ConcurrentWriter&>( *this ); // NOLINT(*-downcast)
+}
+
+const ConcurrentWriter& ConcurrentByteStream::writer() const
+{
+  return static_cast<const ConcurrentWriter&>( *this ); // NOLINT(*-downcast)
+}
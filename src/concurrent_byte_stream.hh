@@ -0,0 +1,82 @@
+#pragma once
+
+#include "eventfd.hh"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+class ConcurrentReader;
+class ConcurrentWriter;
+
+/*
+ * A ByteStream that may be written by one thread and read by another at the same time.
+ *
+ * It offers the same Reader and Writer methods as ByteStream, but the bytes live in a fixed-size
+ * single-producer/single-consumer ring: the writer only ever advances `pushed_` and the reader only
+ * ever advances `popped_` (release stores, acquire loads), so neither side takes a lock or makes a
+ * system call. Optionally, eventfds let either side sleep in poll() until the other makes progress:
+ * clear the eventfd, re-check bytes_buffered() (or available_capacity()), and only then wait.
+ */
+class ConcurrentByteStream
+{
+public:
+  explicit ConcurrentByteStream( uint64_t capacity, bool with_wakeups = false );
+
+  ConcurrentReader& reader();
+  const ConcurrentReader& reader() const;
+  ConcurrentWriter& writer();
+  const ConcurrentWriter& writer() const;
+
+  void set_error(); // Signal that the stream suffered an error.
+  bool has_error() const { return error_.load( std::memory_order_acquire ); }
+
+  // Wakeup eventfds (only if constructed `with_wakeups`): readable_event() fires when bytes are pushed
+  // into a drained stream or the stream is closed or errored, writable_event() fires when bytes are popped
+  // after the writer ran out of space (reserve() or push() filled the stream or came up short), or on error.
+  EventFD& readable_event() { return wakeups_->at( 0 ); }
+  EventFD& writable_event() { return wakeups_->at( 1 ); }
+
+protected:
+  uint64_t capacity_;
+  std::unique_ptr<char[]> buffer_;
+  std::optional<std::array<EventFD, 2>> wakeups_ {};
+
+  alignas( 64 ) std::atomic<uint64_t> pushed_ {}; // written only by the writer thread
+  alignas( 64 ) std::atomic<uint64_t> popped_ {}; // written only by the reader thread
+  alignas( 64 ) std::atomic<bool> closed_ {};
+  std::atomic<bool> error_ {};
+  std::atomic<bool> writer_waiting_ {}; // set by the writer when it runs out of space, cleared by the reader
+
+  void notify( size_t which );
+};
+
+class ConcurrentWriter : public ConcurrentByteStream
+{
+public:
+  void push( std::string data ); // Push data to stream, but only as much as available capacity allows.
+  void close();                  // Signal that the stream has reached its ending. Nothing more will be written.
+
+  std::span<char> reserve( uint64_t len ); // Writable space for up to `len` bytes (see Writer::reserve)
+  void commit( uint64_t len );             // Publish `len` bytes written into the reserved space
+
+  bool is_closed() const;              // Has the stream been closed?
+  uint64_t available_capacity() const; // How many bytes can be pushed to the stream right now?
+  uint64_t bytes_pushed() const;       // Total number of bytes cumulatively pushed to the stream
+};
+
+class ConcurrentReader : public ConcurrentByteStream
+{
+public:
+  std::string_view peek() const; // Peek at the next bytes in the buffer (up to the ring's wrap point).
+  void pop( uint64_t len );      // Remove `len` bytes from the buffer.
+
+  bool is_finished() const;        // Is the stream finished (closed and fully popped)?
+  uint64_t bytes_buffered() const; // Number of bytes currently buffered (pushed and not popped)
+  uint64_t bytes_popped() const;   // Total number of bytes cumulatively popped from stream
+};
@@ -0,0 +1,110 @@
+#include "congestion_control.hh"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+constexpr double kCubicC = 0.4;    // RFC 9438 constant C, in segments per second cubed
+constexpr double kCubicBeta = 0.7; // RFC 9438 multiplicative decrease factor
+constexpr double kCubicAlpha = 3 * ( 1 - kCubicBeta ) / ( 1 + kCubicBeta ); // Reno-friendly additive increase
+} // namespace
+
+// Initial window from RFC 6928
+CongestionControl::CongestionControl( uint64_t mss )
+  : mss_( mss ), cwnd_( min( 10 * mss, max<uint64_t>( 2 * mss, 14600 ) ) )
+{}
+
+// Appropriate byte counting (RFC 3465) with L = 2 * MSS
+void CongestionControl::slow_start( uint64_t acked )
+{
+  cwnd_ += min( acked, 2 * mss_ );
+}
+
+void CongestionControl::on_ack( uint64_t acked, uint64_t /* now_ms */ )
+{
+  if ( in_slow_start() ) {
+    slow_start( acked );
+    return;
+  }
+  // Congestion avoidance: one MSS per window's worth of acknowledged bytes
+  acked_since_increase_ += acked;
+  if ( acked_since_increase_ >= cwnd_ ) {
+    acked_since_increase_ -= cwnd_;
+    cwnd_ += mss_;
+  }
+}
+
+void CongestionControl::on_loss( uint64_t in_flight, uint64_t /* now_ms */ )
+{
+  ssthresh_ = max( in_flight / 2, 2 * mss_ );
+  cwnd_ = ssthresh_;
+  acked_since_increase_ = 0;
+}
+
+void CongestionControl::on_timeout( uint64_t in_flight, uint64_t /* now_ms */ )
+{
+  ssthresh_ = max( in_flight / 2, 2 * mss_ );
+  cwnd_ = mss_;
+  acked_since_increase_ = 0;
+}
+
+void Cubic::reduce()
+{
+  const double segments = static_cast<double>( cwnd_ ) / static_cast<double>( mss_ );
+  // Fast convergence: a flow whose window keeps shrinking releases bandwidth sooner.
+  w_max_ = segments < w_max_ ? segments * ( 1 + kCubicBeta ) / 2 : segments;
+  ssthresh_ = max( static_cast<uint64_t>( static_cast<double>( cwnd_ ) * kCubicBeta ), 2 * mss_ );
+  acked_since_increase_ = 0;
+  epoch_.reset();
+}
+
+void Cubic::on_loss( uint64_t /* in_flight */, uint64_t /* now_ms */ )
+{
+  reduce();
+  cwnd_ = ssthresh_;
+}
+
+void Cubic::on_timeout( uint64_t /* in_flight */, uint64_t /* now_ms */ )
+{
+  reduce();
+  cwnd_ = mss_;
+}
+
+void Cubic::on_ack( uint64_t acked, uint64_t now_ms )
+{
+  if ( in_slow_start() ) {
+    slow_start( acked );
+    return;
+  }
+
+  const double mss = static_cast<double>( mss_ );
+  const double segments = static_cast<double>( cwnd_ ) / mss;
+  if ( not epoch_ ) {
+    epoch_ = now_ms;
+    w_est_ = segments;
+    k_ = cbrt( max( w_max_ - segments, 0.0 ) / kCubicC );
+  }
+
+  // Where the cubic will be one RTT from now, limited to 1.5x the current window
+  const double t = static_cast<double>( now_ms - *epoch_ + latest_rtt_ms_ ) / 1000;
+  const double cubic = kCubicC * pow( t - k_, 3 ) + w_max_;
+  w_est_ += kCubicAlpha * static_cast<double>( acked ) / static_cast<double>( cwnd_ );
+  const double target = clamp( max( cubic, w_est_ ), segments, 1.5 * segments );
+
+  cwnd_ += static_cast<uint64_t>( ( target - segments ) / segments * static_cast<double>( acked ) );
+}
+
+unique_ptr<CongestionControl> make_congestion_control( TCPConfig::CongestionAlgorithm algorithm, uint64_t mss )
+{
+  switch ( algorithm ) {
+    case TCPConfig::CongestionAlgorithm::None:
+      return nullptr;
+    case TCPConfig::CongestionAlgorithm::NewReno:
+      return make_unique<NewReno>( mss );
+    case TCPConfig::CongestionAlgorithm::Cubic:
+      return make_unique<Cubic>( mss );
+  }
+  return nullptr;
+}
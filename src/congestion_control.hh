@@ -0,0 +1,85 @@
+#pragma once
+
+#include "tcp_config.hh"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+
+// Congestion control for a TCPSender. The TCPSender reports what happens to its segments, and keeps no more
+// than window() sequence numbers in flight (on top of whatever the receiver's window allows).
+// Windows are in sequence numbers and times in milliseconds since the TCPSender was created.
+class CongestionControl
+{
+public:
+  explicit CongestionControl( uint64_t mss );
+  virtual ~CongestionControl() = default;
+
+  CongestionControl( const CongestionControl& ) = default;
+  CongestionControl& operator=( const CongestionControl& ) = default;
+  CongestionControl( CongestionControl&& ) = default;
+  CongestionControl& operator=( CongestionControl&& ) = default;
+
+  virtual std::string_view name() const = 0;
+
+  uint64_t window() const { return cwnd_; }                  // Congestion window
+  uint64_t slow_start_threshold() const { return ssthresh_; } // ssthresh
+  bool in_slow_start() const { return cwnd_ < ssthresh_; }
+  void set_mss( uint64_t mss ) { mss_ = mss; } // The segment size changed (e.g. by path MTU discovery).
+
+  // `acked` payload bytes were newly acknowledged.
+  virtual void on_ack( uint64_t acked, uint64_t now_ms );
+
+  // A round-trip time was measured (from a segment that was never retransmitted).
+  virtual void on_rtt_sample( uint64_t rtt_ms ) { latest_rtt_ms_ = rtt_ms; }
+
+  // A loss was detected without a timeout (e.g. by duplicate acks) with `in_flight` sequence numbers outstanding.
+  virtual void on_loss( uint64_t in_flight, uint64_t now_ms );
+
+  // The retransmission timer expired with `in_flight` sequence numbers outstanding.
+  virtual void on_timeout( uint64_t in_flight, uint64_t now_ms );
+
+protected:
+  uint64_t mss_;
+  uint64_t cwnd_;
+  uint64_t ssthresh_ { UINT64_MAX };
+  uint64_t acked_since_increase_ {}; // bytes acked since cwnd last grew in congestion avoidance
+  uint64_t latest_rtt_ms_ {};
+
+  void slow_start( uint64_t acked );
+};
+
+// RFC 5681 slow start and congestion avoidance, halving the window on loss (RFC 6582 recovery is done by the
+// TCPSender)
+class NewReno : public CongestionControl
+{
+public:
+  using CongestionControl::CongestionControl;
+  std::string_view name() const override { return "newreno"; }
+};
+
+// RFC 9438 CUBIC: after a loss the window grows as a cubic function of the time since the loss, centred on
+// the window where the loss happened, but never slower than Reno would.
+class Cubic : public CongestionControl
+{
+public:
+  using CongestionControl::CongestionControl;
+  std::string_view name() const override { return "cubic"; }
+
+  void on_ack( uint64_t acked, uint64_t now_ms ) override;
+  void on_loss( uint64_t in_flight, uint64_t now_ms ) override;
+  void on_timeout( uint64_t in_flight, uint64_t now_ms ) override;
+
+private:
+  double w_max_ {};                  // window (in segments) before the last reduction
+  double w_est_ {};                  // what Reno would have grown the window to (in segments)
+  double k_ {};                      // seconds from the start of the epoch until the cubic reaches w_max_
+  std::optional<uint64_t> epoch_ {}; // when the current congestion-avoidance period started
+
+  void reduce();
+};
+
+// The algorithm selected by `algorithm`, or nullptr for CongestionAlgorithm::None
+std::unique_ptr<CongestionControl> make_congestion_control( TCPConfig::CongestionAlgorithm algorithm,
+                                                            uint64_t mss );
@@ -1,8 +1,49 @@
 #include "reassembler.hh"
 #include "debug.hh"
 
+#include <bit>
+#include <cstring>
+#include <limits>
+
 using namespace std;
 
+namespace {
+constexpr uint64_t kBitsPerWord = 64;
+constexpr uint64_t kMinWindowSize = 512;
+constexpr uint64_t kIdleInsertsBeforeFree = 256; // inserts with nothing pending before the ring is freed
+
+// Bytes allocated for a ring of `size` bytes and its bitmap
+uint64_t ring_footprint( uint64_t size )
+{
+  const uint64_t words = ( size + kBitsPerWord - 1 ) / kBitsPerWord;
+  return words * ( kBitsPerWord + sizeof( uint64_t ) );
+}
+
+// Bits [from, to) of a word, 0 <= from < to <= 64
+uint64_t word_mask( uint64_t from, uint64_t to )
+{
+  return ( to - from == kBitsPerWord ? ~uint64_t {} : ( uint64_t { 1 } << ( to - from ) ) - 1 ) << from;
+}
+
+// Copy `data` into `ring` starting at stream offset `index`, wrapping at the end of the ring.
+void ring_write( string& ring, uint64_t index, string_view data )
+{
+  const uint64_t offset = index % ring.size();
+  const uint64_t first = min( data.size(), ring.size() - offset );
+  memcpy( ring.data() + offset, data.data(), first );
+  memcpy( ring.data(), data.data() + first, data.size() - first );
+}
+
+// Copy `out.size()` bytes out of `ring` starting at stream offset `index`, wrapping at the end of the ring.
+void ring_read( const string& ring, uint64_t index, span<char> out )
+{
+  const uint64_t offset = index % ring.size();
+  const uint64_t first = min( out.size(), ring.size() - offset );
+  memcpy( out.data(), ring.data() + offset, first );
+  memcpy( out.data() + first, ring.data(), out.size() - first );
+}
+} // namespace
+
 void Reassembler::insert( uint64_t first_index, string data, bool is_last_substring )
 {
   // debug( "count_bytes_pending={}", count_bytes_pending() );
@@ -10,78 +51,247 @@ void Reassembler::insert( uint64_t first_index, string data, bool is_last_substr
     return;
   }
 
-  const uint64_t sz = data.size();
-  if ( sz == 0 ) {
-    if ( is_last_substring ) {
-      update_end_ind( first_index );
-      if ( is_wholetask_finished() ) {
-        output_.writer().close();
-      }
-    }
-    return;
+  if ( is_last_substring ) {
+    update_end_ind( first_index + data.size() );
   }
 
+  // Follow the output stream's memory budget, which may be set or changed after construction.
+  pending_charge_.attach( writer().memory_budget() );
+  const shared_ptr<MemoryBudget>& budget = pending_charge_.budget();
+
+  // Keep only the part of the substring inside the window [first unassembled, first unacceptable).
   const uint64_t current_available_ind = writer().bytes_pushed();
-  const uint64_t ceiling_available_ind = current_available_ind + writer().available_capacity() - 1;
+  const uint64_t ceiling_available_ind = current_available_ind + writer().available_capacity();
+  const uint64_t begin = max( first_index, current_available_ind );
+  const uint64_t end = min( first_index + data.size(), ceiling_available_ind );
   // debug( "{} {} {}", current_available_ind, ceiling_available_ind, first_index );
-  if ( ceiling_available_ind < current_available_ind || first_index > ceiling_available_ind
-       || first_index + sz - 1 < current_available_ind ) {
-    return;
+
+  if ( begin >= end ) {
+    stats_.outside_window++;
+  } else if ( begin == current_available_ind ) {
+    // Fast path: the bytes go straight to the stream, and only pending copies of them are dropped.
+    stats_.in_order++;
+    if ( total_pending ) {
+      // The segment may be longer than the ring, which holds nothing beyond its own size.
+      const uint64_t span = min( end - begin, window.size() );
+      const uint64_t ring_begin = begin % window.size();
+      const uint64_t first = min( span, window.size() - ring_begin );
+      total_pending -= clear_held( ring_begin, ring_begin + first ) + clear_held( 0, span - first );
+    }
+    data.resize( end - first_index );
+    data.erase( 0, begin - first_index );
+    output_.writer().push( std::move( data ) );
+    push_ready();
+    trim_recent( writer().bytes_pushed(), numeric_limits<uint64_t>::max() );
+  } else {
+    stats_.out_of_order++;
+    if ( budget and budget->state() == MemoryBudget::State::Exhausted ) {
+      budget->record_refused( end - begin );
+    } else {
+      store( begin, string_view { data }.substr( begin - first_index, end - begin ) );
+      note_held( begin, end );
+      pending_charge_.set( ring_footprint( window.size() ) );
+    }
+    if ( budget and budget->state() != MemoryBudget::State::Normal ) {
+      prune( budget->excess() );
+    }
+  }
+  // Keep an empty ring for the next gap, unless memory is short or no gap has come for a while.
+  if ( total_pending ) {
+    idle_inserts_ = 0;
+  } else if ( ( budget and budget->state() != MemoryBudget::State::Normal )
+              or ++idle_inserts_ >= kIdleInsertsBeforeFree ) {
+    resize_window( 0 );
+    idle_inserts_ = 0;
+  }
+  pending_charge_.set( ring_footprint( window.size() ) );
+
+  if ( is_wholetask_finished() ) {
+    output_.writer().close();
+  }
+}
+
+void Reassembler::store( uint64_t first_index, string_view data )
+{
+  const uint64_t needed = first_index + data.size() - writer().bytes_pushed();
+  if ( window.size() < needed ) {
+    const uint64_t capacity = writer().available_capacity() + reader().bytes_buffered();
+    resize_window( min( capacity, max( { needed, 2 * window.size(), kMinWindowSize } ) ) );
   }
 
-  uint64_t data_start_ind = 0, data_end_ind = sz - 1, last_ind = first_index + sz - 1;
-  if ( is_last_substring )
-    update_end_ind( last_ind + 1 );
+  ring_write( window, first_index, data );
+
+  const uint64_t begin = first_index % window.size();
+  const uint64_t first = min( data.size(), window.size() - begin );
+  total_pending += mark_held( begin, begin + first ) + mark_held( 0, data.size() - first );
+}
 
-  if ( first_index < current_available_ind ) {
-    data_start_ind += current_available_ind - first_index;
-    first_index = current_available_ind;
+void Reassembler::push_ready()
+{
+  if ( total_pending == 0 ) {
+    return;
   }
 
-  if ( last_ind > ceiling_available_ind ) {
-    data_end_ind -= last_ind - ceiling_available_ind;
-    last_ind = ceiling_available_ind;
+  uint64_t first_index = writer().bytes_pushed();
+  const uint64_t begin = first_index % window.size();
+  const uint64_t first = held_run( begin, window.size() );
+  const uint64_t second = begin + first == window.size() ? held_run( 0, begin ) : 0;
+  if ( first == 0 ) {
+    return;
   }
+  clear_held( begin, begin + first );
+  clear_held( 0, second );
 
-  data = data.substr( data_start_ind, data_end_ind - data_start_ind + 1 );
-  // debug( "cut data={}", data );
+  const uint64_t last = first_index + first + second;
+  total_pending -= last - first_index;
 
-  auto it = buf.lower_bound( first_index );
-  if ( it != buf.begin() ) {
-    auto prev = std::prev( it );
-    if ( prev->first + prev->second.size() >= first_index ) {
-      if ( prev->first + prev->second.size() < first_index + data.size() ) {
-        data = prev->second.substr( 0, first_index - prev->first ) + data;
-        first_index = prev->first;
-        total_pending -= prev->second.size();
-        buf.erase( prev );
-      } else {
-        return;
-      }
+  Writer& out = output_.writer();
+  while ( first_index < last ) {
+    const span<char> space = out.reserve( last - first_index );
+    ring_read( window, first_index, space );
+    out.commit( space.size() );
+    first_index += space.size();
+  }
+}
+
+void Reassembler::note_held( uint64_t first_index, uint64_t end )
+{
+  // Absorb the recent ranges that overlap or touch the new one, then put it at the front.
+  Interval merged { first_index, end };
+  size_t kept = 0;
+  for ( size_t i = 0; i < recent_count_; i++ ) {
+    const Interval& r = recent_[i];
+    if ( r.first_index <= merged.end and merged.first_index <= r.end ) {
+      merged = { min( merged.first_index, r.first_index ), max( merged.end, r.end ) };
+    } else {
+      recent_[kept++] = r;
     }
   }
+  recent_count_ = min( kept + 1, recent_.size() );
+  copy_backward( recent_.begin(), recent_.begin() + recent_count_ - 1, recent_.begin() + recent_count_ );
+  recent_.front() = merged;
+}
 
-  while ( it != buf.end() && it->first <= first_index + data.size() - 1 ) {
-    uint64_t overlap = ( first_index + data.size() ) - it->first;
-    if ( overlap < it->second.size() ) {
-      data += it->second.substr( overlap );
+void Reassembler::trim_recent( uint64_t first_index, uint64_t end )
+{
+  size_t kept = 0;
+  for ( size_t i = 0; i < recent_count_; i++ ) {
+    const Interval clipped { max( recent_[i].first_index, first_index ), min( recent_[i].end, end ) };
+    if ( clipped.first_index < clipped.end ) {
+      recent_[kept++] = clipped;
     }
-    total_pending -= it->second.size();
-    it = buf.erase( it );
+  }
+  recent_count_ = kept;
+}
+
+// Like Linux's tcp_prune_ofo_queue(): the bytes furthest from the next expected one are the last that
+// could be assembled, so they go first. Clears whole bitmap words, walking back from the end of the window,
+// until the ring can shrink to what is left by at least `bytes` (or nothing is left), then shrinks it.
+void Reassembler::prune( uint64_t bytes )
+{
+  if ( total_pending == 0 ) {
+    return;
   }
 
-  // debug( "should in {} at {}", data, first_index );
-  total_pending += data.size();
-  buf[first_index] = std::move( data );
+  const uint64_t next = writer().bytes_pushed();
+  const uint64_t head = next % window.size();
+  uint64_t cutoff = next + window.size(); // everything at or beyond this offset has been discarded
+  uint64_t freed = 0;
 
-  while ( buf.size() && writer().bytes_pushed() == buf.begin()->first ) {
-    total_pending -= buf.begin()->second.size();
-    output_.writer().push( std::move( buf.begin()->second ) );
-    buf.erase( buf.begin() );
+  while ( freed < total_pending and cutoff > next
+          and ring_footprint( window.size() ) - ring_footprint( cutoff - next ) < bytes ) {
+    const uint64_t last = ( cutoff - 1 ) % window.size();
+    uint64_t first = last - last % kBitsPerWord;
+    if ( last >= head and first < head ) {
+      first = head; // the word holding the next expected byte; the rest of it is the near end of the window
+    }
+    freed += clear_held( first, last + 1 );
+    cutoff -= last + 1 - first;
   }
-  if ( is_wholetask_finished() ) {
-    output_.writer().close();
+
+  total_pending -= freed;
+  if ( freed ) {
+    stats_.pruned_bytes += freed;
+    pending_charge_.budget()->record_pruned( freed );
+  }
+  trim_recent( next, cutoff );
+  resize_window( total_pending ? cutoff - next : 0 );
+  pending_charge_.set( ring_footprint( window.size() ) );
+}
+
+void Reassembler::resize_window( uint64_t size )
+{
+  const uint64_t words = ( size + kBitsPerWord - 1 ) / kBitsPerWord;
+  if ( words * kBitsPerWord == window.size() ) {
+    return;
+  }
+
+  string resized( words * kBitsPerWord, '\0' );
+  vector<uint64_t> resized_held( words, 0 );
+
+  // Copy the window from the next expected byte on, a stretch at a time that stays within one bitmap word
+  // (and so within the end of the ring) in both the old ring and the new one.
+  const uint64_t next = writer().bytes_pushed();
+  const uint64_t stop = next + ( total_pending ? min( window.size(), resized.size() ) : 0 );
+  for ( uint64_t index = next; index < stop; ) {
+    const uint64_t from = index % window.size();
+    const uint64_t to = index % resized.size();
+    const uint64_t len
+      = min( { kBitsPerWord - from % kBitsPerWord, kBitsPerWord - to % kBitsPerWord, stop - index } );
+    memcpy( resized.data() + to, window.data() + from, len );
+    const uint64_t bits = held[from / kBitsPerWord] & word_mask( from % kBitsPerWord, from % kBitsPerWord + len );
+    resized_held[to / kBitsPerWord] |= bits >> ( from % kBitsPerWord ) << ( to % kBitsPerWord );
+    index += len;
+  }
+
+  // Swap rather than move-assign, so the old allocations are freed here even when the new ring is empty.
+  window.swap( resized );
+  held.swap( resized_held );
+}
+
+uint64_t Reassembler::mark_held( uint64_t begin, uint64_t end )
+{
+  uint64_t newly_held = 0;
+  while ( begin < end ) {
+    const uint64_t bit = begin % kBitsPerWord;
+    const uint64_t stop = min( end - begin + bit, kBitsPerWord );
+    uint64_t& word = held[begin / kBitsPerWord];
+    const uint64_t mask = word_mask( bit, stop );
+    newly_held += popcount( mask & ~word );
+    word |= mask;
+    begin += stop - bit;
+  }
+  return newly_held;
+}
+
+uint64_t Reassembler::clear_held( uint64_t begin, uint64_t end )
+{
+  uint64_t cleared = 0;
+  while ( begin < end ) {
+    const uint64_t bit = begin % kBitsPerWord;
+    const uint64_t stop = min( end - begin + bit, kBitsPerWord );
+    uint64_t& word = held[begin / kBitsPerWord];
+    const uint64_t mask = word_mask( bit, stop );
+    cleared += popcount( mask & word );
+    word &= ~mask;
+    begin += stop - bit;
+  }
+  return cleared;
+}
+
+uint64_t Reassembler::held_run( uint64_t begin, uint64_t end ) const
+{
+  uint64_t run = 0;
+  while ( begin < end ) {
+    const uint64_t bit = begin % kBitsPerWord;
+    const uint64_t ones = min<uint64_t>( countr_one( held[begin / kBitsPerWord] >> bit ), kBitsPerWord - bit );
+    run += min( ones, end - begin );
+    if ( bit + ones < kBitsPerWord or ones >= end - begin ) {
+      break;
+    }
+    begin += ones;
   }
+  return run;
 }
 
 // How many bytes are stored in the Reassembler itself?
@@ -2,9 +2,11 @@
 
 #include "byte_stream.hh"
 #include <algorithm>
-#include <iterator>
-#include <map>
+#include <array>
 #include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
 
 class Reassembler
 {
@@ -45,11 +47,62 @@ public:
   // Access output stream writer, but const-only (can't write from outside)
   const Writer& writer() const { return output_.writer(); }
 
+  // A range [first_index, end) of stream offsets that the Reassembler holds.
+  struct Interval
+  {
+    uint64_t first_index {};
+    uint64_t end {};
+  };
+  static constexpr size_t MAX_HELD_INTERVALS = 4;
+
+  // Up to `max_count` held ranges, most recently extended first (e.g. for SACK blocks). Each range is
+  // entirely held, but a range that hasn't changed recently may be left out. Doesn't allocate or scan
+  // the pending bytes. The view is valid until the next insert().
+  std::span<const Interval> held_intervals( size_t max_count = MAX_HELD_INTERVALS ) const
+  {
+    return { recent_.data(), std::min( max_count, recent_count_ ) };
+  }
+
+  // How often each path through insert() was taken
+  struct Stats
+  {
+    uint64_t in_order {};       // started at the next expected byte and went straight to the stream
+    uint64_t out_of_order {};   // stored in the window to wait for earlier bytes
+    uint64_t outside_window {}; // nothing left once trimmed to the window (duplicates, or beyond capacity)
+    uint64_t pruned_bytes {};   // held bytes discarded because the stream's memory budget was under pressure
+  };
+  const Stats& stats() const { return stats_; }
+
 private:
   ByteStream output_;
   uint64_t total_pending {};
   std::optional<uint64_t> end_ind {};
-  std::map<uint64_t, std::string> buf {};
+  Stats stats_ {};
+  std::array<Interval, MAX_HELD_INTERVALS> recent_ {}; // held ranges, most recently extended first
+  size_t recent_count_ {};
+  MemoryBudget::Charge pending_charge_ {}; // `window` and `held`, charged to the output stream's memory budget
+
+  // Pending bytes are stored in a ring indexed by stream offset modulo its size. Bit i of `held` says
+  // whether ring position i holds a pending byte, so an insert is a memcpy plus setting a range of bits,
+  // whatever the shape of the gaps, and the next contiguous run is found a word at a time. The ring is a
+  // whole number of bitmap words, grown on demand (never past the stream's capacity) and shrunk when pruned.
+  // Once nothing is pending it is kept for the next gap, but freed under memory pressure or after
+  // `idle_inserts_` reaches a threshold, so idle or pruned connections don't keep a full-capacity buffer.
+  std::string window {};
+  std::vector<uint64_t> held {};
+  uint64_t idle_inserts_ {}; // consecutive inserts that left nothing pending
+
   bool is_wholetask_finished() const;
   void update_end_ind( const uint64_t new_index );
+  void store( uint64_t first_index, std::string_view data ); // Copy `data` into the window and mark it held.
+  void push_ready();                                         // Write the run at the front of the window.
+  void note_held( uint64_t first_index, uint64_t end );      // Record a newly stored range as most recent.
+  void trim_recent( uint64_t first_index, uint64_t end );    // Clip the recent ranges to [first_index, end).
+  void prune( uint64_t bytes ); // Discard held bytes, furthest first, until the ring can shrink by `bytes`.
+  void resize_window( uint64_t size ); // Move the held bytes into a ring of `size` bytes (zero frees it).
+
+  // Operations on the bits for ring positions [begin, end), which must not wrap.
+  uint64_t mark_held( uint64_t begin, uint64_t end );      // Returns how many of the bits were newly set.
+  uint64_t clear_held( uint64_t begin, uint64_t end );     // Returns how many of the bits had been set.
+  uint64_t held_run( uint64_t begin, uint64_t end ) const; // How many bits from `begin` on are set?
 };
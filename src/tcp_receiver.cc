@@ -12,6 +12,7 @@ void TCPReceiver::receive( TCPSenderMessage message )
   }
   if ( message.SYN && !zero_checkpoint_.has_value() ) {
     zero_checkpoint_ = Wrap32( message.seqno );
+    peer_sack_permitted_ = message.SACK_permitted;
   }
   if ( zero_checkpoint_.has_value() ) {
     const uint64_t check_point = writer().bytes_pushed() + 1;
@@ -24,11 +25,25 @@ void TCPReceiver::receive( TCPSenderMessage message )
 
 TCPReceiverMessage TCPReceiver::send() const
 {
-  return TCPReceiverMessage {
+  // Under memory pressure, advertise only part of the free space.
+  uint64_t window = writer().available_capacity();
+  if ( writer().memory_budget() ) {
+    window = writer().memory_budget()->clamp_window( window );
+  }
+  TCPReceiverMessage msg {
     ( zero_checkpoint_.has_value()
         ? Wrap32::wrap( writer().bytes_pushed() + 1 + static_cast<uint64_t>( writer().is_closed() ),
                         zero_checkpoint_.value() )
         : optional<Wrap32> {} ),
-    static_cast<uint16_t>( min( writer().available_capacity(), static_cast<uint64_t>( UINT16_MAX ) ) ),
+    static_cast<uint32_t>( min( window, max_window_ ) ),
     reader().has_error() };
+
+  // Report the out-of-order data we hold, the block with the latest arrival first (RFC 2018).
+  if ( sack_enabled_ and peer_sack_permitted_ and zero_checkpoint_.has_value() ) {
+    for ( const auto& held : reassembler_.held_intervals( TCPReceiverMessage::MAX_SACK_BLOCKS ) ) {
+      msg.add_sack_block( { Wrap32::wrap( held.first_index + 1, *zero_checkpoint_ ),
+                            Wrap32::wrap( held.end + 1, *zero_checkpoint_ ) } );
+    }
+  }
+  return msg;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "reassembler.hh"
+#include "tcp_config.hh"
 #include "tcp_receiver_message.hh"
 #include "tcp_sender_message.hh"
 #include <algorithm>
@@ -11,6 +12,14 @@ public:
   // Construct with given Reassembler
   explicit TCPReceiver( Reassembler&& reassembler ) : reassembler_( std::move( reassembler ) ) {}
 
+  // Construct with given Reassembler, sending SACK blocks if `config.sack` is set and the peer permits them,
+  // and advertising windows beyond 65,535 bytes if `config.window_scaling` is set
+  TCPReceiver( Reassembler&& reassembler, const TCPConfig& config )
+    : reassembler_( std::move( reassembler ) )
+    , sack_enabled_( config.sack )
+    , max_window_( config.window_scaling ? uint64_t { UINT16_MAX } << config.window_shift() : UINT16_MAX )
+  {}
+
   /*
    * The TCPReceiver receives TCPSenderMessages, inserting their payload into the Reassembler
    * at the correct stream index.
@@ -29,4 +38,7 @@ public:
 private:
   Reassembler reassembler_;
   std::optional<Wrap32> zero_checkpoint_ {};
+  bool sack_enabled_ {};
+  bool peer_sack_permitted_ {}; // the peer's SYN carried SACK_permitted
+  uint64_t max_window_ { UINT16_MAX }; // the largest window the header can carry (with our window scale)
 };
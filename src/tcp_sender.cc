@@ -1,7 +1,13 @@
 #include "tcp_sender.hh"
+#include "chunk_pool.hh"
 #include "debug.hh"
 #include "tcp_config.hh"
 
+#include <algorithm>
+#include <cmath>
+#include <ranges>
+#include <utility>
+
 using namespace std;
 
 // How many sequence numbers are outstanding?
@@ -16,40 +22,311 @@ uint64_t TCPSender::consecutive_retransmissions() const
   return retransmissions_count;
 }
 
+uint64_t TCPSender::current_RTO_ms() const
+{
+  return timer.getRTO();
+}
+
+optional<uint64_t> TCPSender::srtt_ms() const
+{
+  return rtt_estimator_ ? rtt_estimator_->SRTT() : nullopt;
+}
+
+optional<uint64_t> TCPSender::ms_until_next_send() const
+{
+  optional<uint64_t> next;
+  if ( pacer_ and paced_ ) {
+    next = pacer_->msUntilTransmit();
+  }
+  if ( held_since_ms_ ) {
+    const uint64_t due = *held_since_ms_ + hold_timeout_ms_;
+    next = min( next.value_or( UINT64_MAX ), due - min( due, now_ms_ ) );
+  }
+  return next;
+}
+
+// Send a small segment only if it is all there is to send and nothing is unacknowledged (Nagle; never while
+// corked), or if it takes up at least half of the largest window the receiver has offered (RFC 1122
+// 4.2.3.4). Full-sized segments, the end of the stream and zero-window probes are never held back.
+bool TCPSender::hold_back( uint64_t room ) const
+{
+  const uint64_t buffered = reader().bytes_buffered();
+  if ( not( nagle_ or corked_ ) or flush_ or buffered == 0 or input_.writer().is_closed() or window_size == 0 ) {
+    return false;
+  }
+  const uint64_t sendable = min( { buffered, room, mss_ } );
+  if ( sendable == mss_ ) {
+    return false;
+  }
+  if ( corked_ ) {
+    return true;
+  }
+  if ( sendable == buffered and outstanding_count == 0 ) {
+    return false;
+  }
+  return sendable < max_window_ / 2;
+}
+
+void TCPSender::flush( const TransmitFunction& transmit )
+{
+  flush_ = true;
+  push( transmit );
+  flush_ = false;
+}
+
+void TCPSender::uncork( const TransmitFunction& transmit )
+{
+  corked_ = false;
+  flush( transmit );
+}
+
+// An explicit rate, or (as in Linux) twice the congestion window per SRTT in slow start, so pacing doesn't
+// hold back the window's growth, and 1.2 times it afterwards.
+void TCPSender::update_pacing_rate()
+{
+  if ( not pacer_ ) {
+    return;
+  }
+  if ( pacing_rate_ ) {
+    pacer_->setRate( static_cast<double>( pacing_rate_ ) / 1000 );
+    return;
+  }
+  const optional<uint64_t> srtt = srtt_ms();
+  if ( not congestion_control_ or not srtt ) {
+    pacer_->setRate( 0 );
+    return;
+  }
+  const double ratio = congestion_control_->in_slow_start() ? 2.0 : 1.2;
+  pacer_->setRate( ratio * static_cast<double>( congestion_control_->window() )
+                   / static_cast<double>( max<uint64_t>( *srtt, 1 ) ) );
+}
+
+uint64_t TCPSender::pipe() const
+{
+  return outstanding_count - sacked_count_ - lost_count_;
+}
+
+// What is left of the receiver's window (or 1, to probe a zero window) and of the congestion window
+uint64_t TCPSender::send_room() const
+{
+  const uint64_t receiver_window = window_size ? window_size : 1;
+  uint64_t room = receiver_window - min( receiver_window, outstanding_count );
+  if ( not congestion_control_ ) {
+    return room;
+  }
+  // Limited transmit lets each of the first duplicate acks release one new segment; fast recovery inflates
+  // the window by a segment for each duplicate ack (each one means a segment has left the network).
+  // With SACK, pipe() already leaves out the segments that have left the network.
+  uint64_t extra = recover_ ? window_inflation_ : dup_acks_ * mss_;
+  if ( sack_seen_ ) {
+    extra = 0;
+  }
+  const uint64_t congestion_window = congestion_control_->window() + extra;
+  room = min( room, congestion_window - min( congestion_window, pipe() ) );
+  return room;
+}
+
 void TCPSender::push( const TransmitFunction& transmit )
 {
-  const uint64_t available_space = window_size ? window_size : 1;
   uint64_t payload_size { 0 };
   TCPSenderMessage msg;
 
-  while ( available_space > outstanding_count ) {
+  update_pacing_rate();
+  paced_ = false;
+  const optional<uint64_t> held_since = exchange( held_since_ms_, nullopt );
+
+  if ( retransmit_pending_ ) {
+    retransmit_pending_ = false;
+    if ( not outstanding_message_.empty() ) {
+      retransmit( 0, transmit );
+    }
+  }
+  retransmit_lost( transmit );
+
+  for ( uint64_t room = send_room(); room > 0; room = send_room() ) {
     msg = make_empty_message();
     if ( isFIN )
       break;
-    if ( !isSYN )
+    if ( isSYN and hold_back( room ) ) {
+      held_since_ms_ = held_since.value_or( now_ms_ );
+      break;
+    }
+    if ( pacer_ and not pacer_->mayTransmit() ) {
+      paced_ = reader().bytes_buffered() or reader().is_finished() or !isSYN; // tick() sends it later
+      break;
+    }
+    if ( !isSYN ) {
       msg.SYN = isSYN = true;
+      msg.SACK_permitted = sack_;
+    }
+
+    if ( msg.SYN ) {
+      msg.MSS = advertised_mss_;
+      msg.window_scale = window_scale_;
+    }
 
     msg.seqno = Wrap32::wrap( sentno_, isn_ );
-    payload_size = min( TCPConfig::MAX_PAYLOAD_SIZE, available_space - outstanding_count - msg.SYN );
+    const uint64_t probe = msg.SYN ? 0 : next_probe_size();
+    const bool probing = probe and reader().bytes_buffered() >= probe and room >= probe;
+    payload_size = probing ? probe : min( mss_, room - msg.SYN );
 
+    if ( payload_size and reader().bytes_buffered() )
+      msg.payload = ChunkPool::local().acquire( min( payload_size, reader().bytes_buffered() ) );
     read( input_.reader(), payload_size, msg.payload );
 
-    if ( !isFIN && reader().is_finished() && outstanding_count + msg.sequence_length() < available_space )
+    if ( !isFIN && reader().is_finished() && msg.sequence_length() < room )
       msg.FIN = isFIN = true;
 
     if ( msg.sequence_length() == 0 )
       return;
 
     transmit( msg );
+    if ( pacer_ )
+      pacer_->spend( msg.sequence_length() );
     if ( !timer.isValid() )
       timer.start();
 
+    outstanding_message_.push_back( { sentno_, msg.payload.size(), msg.SYN, msg.FIN, now_ms_, false } );
+    if ( probing ) {
+      outstanding_message_.back().probe = true;
+      probe_size_ = probe;
+    }
     sentno_ += msg.sequence_length();
     outstanding_count += msg.sequence_length();
-    outstanding_message_.emplace( std::move( msg ) );
+    ChunkPool::local().release( std::move( msg.payload ) ); // the bytes themselves stay in the stream
+  }
+}
+
+// The stream retains every unacknowledged payload byte, so a segment can be rebuilt from its position.
+TCPSenderMessage TCPSender::make_message( const Outstanding& segment ) const
+{
+  TCPSenderMessage msg = make_empty_message();
+  msg.seqno = Wrap32::wrap( segment.seqno, isn_ );
+  msg.SYN = segment.SYN;
+  msg.SACK_permitted = segment.SYN and sack_;
+  msg.MSS = segment.SYN ? advertised_mss_ : 0;
+  msg.window_scale = segment.SYN ? window_scale_ : nullopt;
+  msg.FIN = segment.FIN;
+  if ( segment.length ) {
+    const uint64_t oldest_retained = reader().bytes_popped() - reader().bytes_retained();
+    const uint64_t first_byte = segment.seqno + segment.SYN - 1; // stream index (the SYN takes seqno 0)
+    msg.payload = ChunkPool::local().acquire( segment.length );
+    for ( const string_view piece : reader().peek_retained( first_byte - oldest_retained, segment.length ) ) {
+      msg.payload.append( piece );
+    }
+  }
+  return msg;
+}
+
+// Like Linux's tcp_retrans_try_collapse(): a retransmission carries as many of the following outstanding
+// bytes as fit in one segment, so data written in small pieces is resent in few, full-sized segments. Only
+// segments in the same state are merged (lost ones with lost ones), and never SACKed ones.
+void TCPSender::coalesce( size_t index )
+{
+  if ( not repacketize_ ) {
+    return;
+  }
+  Outstanding& segment = outstanding_message_.at( index );
+  while ( index + 1 < outstanding_message_.size() ) {
+    const Outstanding& next = outstanding_message_[index + 1];
+    if ( segment.SYN or segment.FIN or next.sacked or next.lost != segment.lost
+         or segment.length + next.length > mss_ ) {
+      break;
+    }
+    segment.length += next.length;
+    segment.FIN = next.FIN;
+    segment.retransmitted = segment.retransmitted or next.retransmitted;
+    outstanding_message_.erase( outstanding_message_.begin() + static_cast<ptrdiff_t>( index ) + 1 );
+  }
+}
+
+void TCPSender::retransmit( size_t index, const TransmitFunction& transmit )
+{
+  if ( outstanding_message_.at( index ).length > mss_ ) {
+    split( index );
+  }
+  Outstanding& segment = outstanding_message_.at( index );
+  TCPSenderMessage msg = make_message( segment );
+  transmit( msg );
+  if ( pacer_ ) {
+    pacer_->spend( msg.sequence_length() ); // sent at once, but counted against what follows
+  }
+  ChunkPool::local().release( std::move( msg.payload ) );
+  segment.retransmitted = true;
+  if ( segment.lost ) {
+    segment.lost = false;
+    lost_count_ -= segment.sequence_length();
+  }
+}
+
+// A lost probe was most likely too big for the path, so the search goes on below it. Its data (or that of a
+// segment sent before mss_ was lowered) is resent in segments that fit: the caller resends the first, and
+// the others are marked lost for retransmit_lost().
+void TCPSender::split( size_t index )
+{
+  const Outstanding segment = outstanding_message_.at( index );
+  if ( segment.probe ) {
+    search_high_ = probe_size_ - 1;
+    probe_size_ = 0;
+  }
+  if ( segment.lost ) {
+    lost_count_ -= segment.sequence_length();
+  }
+  outstanding_message_.erase( outstanding_message_.begin() + static_cast<ptrdiff_t>( index ) );
+
+  uint64_t seqno = segment.seqno;
+  auto position = outstanding_message_.begin() + static_cast<ptrdiff_t>( index );
+  for ( uint64_t offset = 0; offset < segment.length; ) {
+    Outstanding piece = segment;
+    piece.seqno = seqno;
+    piece.length = min( mss_, segment.length - offset );
+    piece.SYN = segment.SYN and offset == 0;
+    piece.FIN = segment.FIN and offset + piece.length == segment.length;
+    piece.lost = piece.probe = false;
+    offset += piece.length;
+    seqno += piece.sequence_length();
+    position = outstanding_message_.insert( position, piece ) + 1;
+  }
+  for ( size_t i = index + 1; i < outstanding_message_.size() and outstanding_message_[i].seqno < seqno; i++ ) {
+    mark_lost( outstanding_message_[i] );
   }
 }
 
+void TCPSender::set_peer_mss( uint64_t mss )
+{
+  search_high_ = min( search_high_, mss );
+  if ( mss < mss_ ) {
+    set_mss( mss );
+  }
+}
+
+void TCPSender::decline_window_scale()
+{
+  if ( !isSYN ) {
+    window_scale_.reset();
+  }
+}
+
+void TCPSender::set_mss( uint64_t mss )
+{
+  mss_ = mss;
+  if ( congestion_control_ ) {
+    congestion_control_->set_mss( mss );
+  }
+  if ( pacer_ ) {
+    pacer_->setBurst( TCPConfig::PACING_BURST_SEGMENTS * mss );
+  }
+}
+
+// Probe halfway between mss_ and search_high_, one probe at a time and not while recovering from a loss
+uint64_t TCPSender::next_probe_size() const
+{
+  if ( not mtu_probing_ or probe_size_ or recover_ or lost_count_ or search_high_ < mss_ + PROBE_THRESHOLD ) {
+    return 0;
+  }
+  return mss_ + ( search_high_ - mss_ + 1 ) / 2;
+}
+
 TCPSenderMessage TCPSender::make_empty_message() const
 {
   return TCPSenderMessage { Wrap32::wrap( sentno_, isn_ ), false, string {}, false, input_.has_error() };
@@ -57,7 +334,9 @@ TCPSenderMessage TCPSender::make_empty_message() const
 
 void TCPSender::receive( const TCPReceiverMessage& msg )
 {
+  const bool window_changed = window_size != msg.window_size;
   window_size = msg.window_size;
+  max_window_ = max( max_window_, window_size );
   if ( msg.RST ) {
     input_.set_error();
     return;
@@ -70,41 +349,247 @@ void TCPSender::receive( const TCPReceiverMessage& msg )
     return;
 
   bool hasackmsg { false };
-  while ( outstanding_message_.size() ) {
-    TCPSenderMessage& item = outstanding_message_.front();
+  uint64_t acked_bytes = 0;
+  optional<uint64_t> rtt_ms;
+  while ( outstanding_message_.size() and ackno_ < abs_ackno ) {
+    Outstanding& item = outstanding_message_.front();
     if ( item.sequence_length() + ackno_ <= abs_ackno ) {
       outstanding_count -= item.sequence_length();
+      sacked_count_ -= item.sacked ? item.sequence_length() : 0;
+      lost_count_ -= item.lost ? item.sequence_length() : 0;
       ackno_ += item.sequence_length();
-      outstanding_message_.pop();
-
-      hasackmsg = true;
+      acked_bytes += item.length;
+      if ( not item.retransmitted ) {
+        rtt_ms = now_ms_ - item.sent_ms;
+      }
+      if ( item.probe ) {
+        set_mss( probe_size_ ); // the path delivered it
+        probe_size_ = 0;
+      }
+      input_.reader().release( item.length );
+      outstanding_message_.pop_front();
+    } else if ( repacketize_ ) {
+      // Part of a segment (e.g. one that was repacketized): keep only the unacknowledged bytes.
+      const uint64_t acked = abs_ackno - ackno_;
+      const uint64_t payload_acked = acked - item.SYN;
+      outstanding_count -= acked;
+      sacked_count_ -= item.sacked ? acked : 0;
+      lost_count_ -= item.lost ? acked : 0;
+      ackno_ = item.seqno = abs_ackno;
+      item.SYN = false;
+      item.length -= payload_acked;
+      acked_bytes += payload_acked;
+      input_.reader().release( payload_acked );
     } else {
-      break;
+      break; // the segment stays outstanding, and is retransmitted whole, until all of it is acknowledged
     }
+    hasackmsg = true;
   }
 
+  update_scoreboard( msg );
+
   if ( hasackmsg ) {
-    timer.reset();
-    retransmissions_count = 0;
-    if ( outstanding_message_.empty() ) {
-      timer.inValid();
-    } else {
-      timer.start();
+    on_new_ack( acked_bytes, rtt_ms );
+  } else if ( fast_retransmit_ and abs_ackno == ackno_ and outstanding_count and not window_changed ) {
+    on_duplicate_ack();
+  }
+
+  // The scoreboard can find the first segment lost before three duplicate acks arrive.
+  if ( not recover_ and not outstanding_message_.empty() and outstanding_message_.front().lost ) {
+    enter_recovery();
+  }
+}
+
+// Record the segments that SACK blocks cover, then mark the unSACKed segments below them lost once
+// DupThresh segments (or more than DupThresh - 1 full segments' worth of sequence numbers) above them
+// have been SACKed (IsLost() in RFC 6675).
+void TCPSender::update_scoreboard( const TCPReceiverMessage& msg )
+{
+  if ( not sack_ ) {
+    return;
+  }
+
+  for ( const auto& block : msg.sack_blocks() ) {
+    const uint64_t begin = block.begin.unwrap( isn_, ackno_ );
+    const uint64_t end = block.end.unwrap( isn_, ackno_ );
+    if ( begin < ackno_ or end > sentno_ or begin >= end ) {
+      continue; // old, or not something we sent
+    }
+    sack_seen_ = true;
+    for ( auto& segment : outstanding_message_ ) {
+      const uint64_t seqno = segment.seqno;
+      const uint64_t length = segment.sequence_length();
+      if ( seqno >= end ) {
+        break;
+      }
+      if ( not segment.sacked and seqno >= begin and seqno + length <= end ) {
+        segment.sacked = true;
+        sacked_count_ += length;
+        if ( segment.lost ) {
+          segment.lost = false;
+          lost_count_ -= length;
+        }
+      }
+    }
+  }
+
+  uint64_t sacked_segments_above = 0;
+  uint64_t sacked_above = 0;
+  for ( auto& segment : views::reverse( outstanding_message_ ) ) {
+    if ( segment.sacked ) {
+      sacked_segments_above++;
+      sacked_above += segment.sequence_length();
+    } else if ( not segment.retransmitted
+                and ( sacked_segments_above >= DUP_ACK_THRESHOLD
+                      or sacked_above > ( DUP_ACK_THRESHOLD - 1 ) * mss_ ) ) {
+      mark_lost( segment );
+    }
+  }
+}
+
+void TCPSender::mark_lost( Outstanding& segment )
+{
+  if ( segment.sacked or segment.lost ) {
+    return;
+  }
+  segment.lost = true;
+  lost_count_ += segment.sequence_length();
+}
+
+// Retransmit the holes marked lost, lowest first, as far as the congestion window allows
+void TCPSender::retransmit_lost( const TransmitFunction& transmit )
+{
+  for ( size_t i = 0; i < outstanding_message_.size(); i++ ) {
+    if ( lost_count_ == 0 or ( congestion_control_ and pipe() >= congestion_control_->window() ) ) {
+      break;
+    }
+    if ( outstanding_message_[i].lost ) {
+      coalesce( i );
+      retransmit( i, transmit );
+    }
+  }
+}
+
+void TCPSender::on_duplicate_ack()
+{
+  dup_acks_++;
+  if ( recover_ ) {
+    window_inflation_ += mss_;
+    return;
+  }
+  // Duplicate acks for data sent before the last recovery or timeout say nothing new about loss (RFC 6582).
+  if ( dup_acks_ < DUP_ACK_THRESHOLD or ackno_ < recover_point_ ) {
+    return;
+  }
+  enter_recovery();
+}
+
+// Enter fast recovery: until everything sent so far is acknowledged, each ack that doesn't cover it all
+// means the segment after it was lost too.
+void TCPSender::enter_recovery()
+{
+  if ( outstanding_message_.front().probe ) {
+    // Only the path MTU probe was lost, most likely for being too big rather than from congestion: resend its
+    // data (from push()) in smaller segments without slowing down.
+    split( 0 );
+    dup_acks_ = 0;
+    retransmit_pending_ = true;
+    return;
+  }
+  recover_ = recover_point_ = sentno_;
+  if ( congestion_control_ ) {
+    congestion_control_->on_loss( outstanding_count, now_ms_ );
+  }
+  if ( sack_seen_ ) {
+    mark_lost( outstanding_message_.front() ); // retransmitted with the other holes by push()
+    return;
+  }
+  retransmit_pending_ = true;
+  if ( congestion_control_ ) {
+    window_inflation_ = DUP_ACK_THRESHOLD * mss_;
+  }
+}
+
+void TCPSender::on_new_ack( uint64_t acked_bytes, optional<uint64_t> rtt_ms )
+{
+  dup_acks_ = 0;
+  if ( rtt_ms and rtt_estimator_ ) {
+    rtt_estimator_->sample( *rtt_ms );
+    timer.setRTO( rtt_estimator_->RTO() );
+  }
+
+  if ( recover_ and ackno_ >= *recover_ ) {
+    recover_.reset(); // full ack: deflate the window back to ssthresh
+    window_inflation_ = 0;
+  } else if ( recover_ and sack_seen_ ) {
+    // Partial ack: the segment at the new ackno is a hole, unless it has been retransmitted already.
+    if ( not outstanding_message_.front().retransmitted ) {
+      mark_lost( outstanding_message_.front() );
+    }
+  } else if ( recover_ ) {
+    // Partial ack: retransmit the next hole, and take back the room the acked data had used.
+    retransmit_pending_ = true;
+    window_inflation_ = window_inflation_ - min( window_inflation_, acked_bytes ) + mss_;
+  } else if ( congestion_control_ ) {
+    if ( rtt_ms ) {
+      congestion_control_->on_rtt_sample( *rtt_ms );
     }
+    congestion_control_->on_ack( acked_bytes, now_ms_ );
+  }
+
+  timer.reset();
+  retransmissions_count = 0;
+  if ( outstanding_message_.empty() ) {
+    timer.inValid();
+  } else {
+    timer.start();
   }
 }
 
 void TCPSender::tick( uint64_t ms_since_last_tick, const TransmitFunction& transmit )
 {
+  now_ms_ += ms_since_last_tick;
   timer.tick( ms_since_last_tick );
+  if ( pacer_ ) {
+    pacer_->tick( ms_since_last_tick );
+  }
   if ( timer.isExpired() && outstanding_message_.size() ) {
-    transmit( outstanding_message_.front() );
-    if ( window_size != 0 ) {
+    // The receiver may have discarded data it SACKed (reneging, RFC 2018), so start the scoreboard over.
+    for ( auto& segment : outstanding_message_ ) {
+      segment.sacked = segment.lost = false;
+    }
+    sacked_count_ = lost_count_ = 0;
+    // A path MTU probe that times out was most likely too big, which says nothing about congestion.
+    const bool probe_lost = outstanding_message_.front().probe;
+    const bool black_hole = retransmissions_count + 1 >= BLACK_HOLE_TIMEOUTS and mss_ > base_mss_;
+    if ( mtu_probing_ and not probe_lost and black_hole ) {
+      // Segments keep timing out: the path MTU may have shrunk (a black hole), so start the search over.
+      search_high_ = mss_ - 1;
+      set_mss( base_mss_ );
+    }
+    coalesce( 0 );
+    retransmit( 0, transmit );
+    recover_.reset();
+    recover_point_ = sentno_;
+    window_inflation_ = 0;
+    dup_acks_ = 0;
+    if ( window_size != 0 and not probe_lost ) {
+      // A timeout with an open window means congestion, not a zero-window probe going unanswered.
+      if ( congestion_control_ and retransmissions_count == 0 ) {
+        congestion_control_->on_timeout( outstanding_count, now_ms_ );
+      }
       retransmissions_count++;
       timer.exp_Backoff();
     }
+    retransmit_lost( transmit ); // the rest of a segment that was split for being too big
     timer.start();
   }
+
+  if ( held_since_ms_ and now_ms_ - *held_since_ms_ >= hold_timeout_ms_ ) {
+    flush( transmit );
+  } else if ( paced_ ) {
+    push( transmit );
+  }
 }
 
 void Timer::start()
@@ -131,7 +616,22 @@ void Timer::tick( uint64_t time_since_last_tick )
 
 void Timer::exp_Backoff()
 {
-  curr_RTO_ms *= 2;
+  curr_RTO_ms = curr_RTO_ms > max_RTO_ms / 2 ? max( max_RTO_ms, curr_RTO_ms ) : curr_RTO_ms * 2;
+}
+
+void Timer::setRTO( uint64_t RTO )
+{
+  init_RTO_ms = RTO;
+}
+
+void Timer::setMaxRTO( uint64_t max_RTO )
+{
+  max_RTO_ms = max_RTO;
+}
+
+uint64_t Timer::getRTO() const
+{
+  return curr_RTO_ms;
 }
 
 bool Timer::isValid() const
@@ -143,3 +643,64 @@ bool Timer::isExpired() const
 {
   return valid && time_ms >= curr_RTO_ms;
 }
+
+void RTTEstimator::sample( uint64_t rtt_ms )
+{
+  const double r = static_cast<double>( rtt_ms );
+  if ( not srtt_ms ) {
+    srtt_ms = r;
+    rttvar_ms = r / 2;
+    return;
+  }
+  rttvar_ms = 0.75 * rttvar_ms + 0.25 * abs( *srtt_ms - r );
+  srtt_ms = 0.875 * *srtt_ms + 0.125 * r;
+}
+
+optional<uint64_t> RTTEstimator::SRTT() const
+{
+  if ( not srtt_ms ) {
+    return nullopt;
+  }
+  return static_cast<uint64_t>( llround( *srtt_ms ) );
+}
+
+uint64_t RTTEstimator::RTO() const
+{
+  // The clock granularity G is the 1 ms resolution of tick().
+  const double rto = srtt_ms.value_or( 0 ) + max( 1.0, 4 * rttvar_ms );
+  return clamp( static_cast<uint64_t>( ceil( rto ) ), min_RTO_ms, max_RTO_ms );
+}
+
+void Pacer::setRate( double per_ms )
+{
+  rate_ = per_ms;
+}
+
+void Pacer::setBurst( uint64_t burst )
+{
+  burst_ = static_cast<double>( burst );
+  tokens_ = min( tokens_, burst_ ); // tokens saved up under a larger burst don't carry over
+}
+
+void Pacer::tick( uint64_t ms_since_last_tick )
+{
+  // Time only advances in whole milliseconds, so at least a millisecond's worth of tokens can be saved up.
+  tokens_ = min( max( burst_, rate_ ), tokens_ + rate_ * static_cast<double>( ms_since_last_tick ) );
+}
+
+void Pacer::spend( uint64_t sequence_length )
+{
+  if ( rate_ > 0 ) {
+    tokens_ -= static_cast<double>( sequence_length );
+  }
+}
+
+bool Pacer::mayTransmit() const
+{
+  return rate_ <= 0 or tokens_ > 0;
+}
+
+uint64_t Pacer::msUntilTransmit() const
+{
+  return mayTransmit() ? 0 : static_cast<uint64_t>( floor( -tokens_ / rate_ ) ) + 1;
+}
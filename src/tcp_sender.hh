@@ -1,16 +1,22 @@
 #pragma once
 
 #include "byte_stream.hh"
+#include "congestion_control.hh"
+#include "tcp_config.hh"
 #include "tcp_receiver_message.hh"
 #include "tcp_sender_message.hh"
 
+#include <algorithm>
+#include <deque>
 #include <functional>
-#include <queue>
+#include <memory>
+#include <optional>
 
 class Timer
 {
 private:
   uint64_t init_RTO_ms {}, curr_RTO_ms {}, time_ms {};
+  uint64_t max_RTO_ms { UINT64_MAX };
   bool valid { false };
 
 public:
@@ -20,17 +26,87 @@ public:
   void inValid();
   void tick( uint64_t time_since_last_tick );
   void exp_Backoff();
+  void setRTO( uint64_t RTO );        // Change the RTO that reset() returns to (takes effect on reset()).
+  void setMaxRTO( uint64_t max_RTO ); // Stop backing off at `max_RTO`.
+  uint64_t getRTO() const;            // Current RTO, including any backoff
   bool isValid() const;
   bool isExpired() const;
 };
 
+// RFC 6298 estimation of the smoothed RTT and its variation, and the RTO derived from them
+class RTTEstimator
+{
+private:
+  std::optional<double> srtt_ms {};
+  double rttvar_ms {};
+  uint64_t min_RTO_ms {}, max_RTO_ms {};
+
+public:
+  RTTEstimator( uint64_t min_RTO, uint64_t max_RTO ) : min_RTO_ms( min_RTO ), max_RTO_ms( max_RTO ) {}
+  void sample( uint64_t rtt_ms );      // Take a measurement from a segment that was never retransmitted.
+  std::optional<uint64_t> SRTT() const; // Smoothed RTT (none until the first sample)
+  uint64_t RTO() const;                 // SRTT + 4 * RTTVAR, within [min_RTO, max_RTO]
+};
+
+// Token bucket for pacing: tokens (sequence numbers) accrue at the pacing rate, up to a small burst, and
+// each segment spends its length. A segment may go out while any tokens are left, so the bucket can go
+// into debt; the debt is what decides when the next segment may follow.
+class Pacer
+{
+private:
+  double rate_ {};   // sequence numbers per millisecond (0: not pacing yet)
+  double burst_ {};  // most tokens that can be saved up
+  double tokens_ {}; // sequence numbers that may be sent now (negative: owed)
+
+public:
+  explicit Pacer( uint64_t burst ) : burst_( static_cast<double>( burst ) ), tokens_( burst_ ) {}
+  void setRate( double per_ms );
+  void setBurst( uint64_t burst ); // the segment size changed
+  void tick( uint64_t ms_since_last_tick );
+  void spend( uint64_t sequence_length );
+  bool mayTransmit() const;
+  uint64_t msUntilTransmit() const; // 0 if a segment may go out now
+};
+
 class TCPSender
 {
 public:
   /* Construct TCP sender with given default Retransmission Timeout and possible ISN */
   TCPSender( ByteStream&& input, Wrap32 isn, uint64_t initial_RTO_ms )
     : input_( std::move( input ) ), isn_( isn ), initial_RTO_ms_( initial_RTO_ms ), timer( initial_RTO_ms )
-  {}
+  {
+    input_.set_retain_popped( true ); // sent bytes stay in the stream until acknowledged
+  }
+
+  /* Construct TCP sender with the ISN, timeout and congestion control given by `config` */
+  TCPSender( ByteStream&& input, const TCPConfig& config )
+    : TCPSender( std::move( input ), config.isn, config.rt_timeout )
+  {
+    mss_ = config.mss;
+    advertised_mss_ = static_cast<uint16_t>( std::min<uint64_t>( config.mss, UINT16_MAX ) );
+    if ( config.window_scaling ) {
+      window_scale_ = config.window_shift();
+    }
+    if ( config.mtu_probing ) {
+      mtu_probing_ = true;
+      search_high_ = mss_;
+      mss_ = base_mss_ = std::min( mss_, TCPConfig::MAX_PAYLOAD_SIZE );
+    }
+    congestion_control_ = make_congestion_control( config.congestion_control, mss_ );
+    if ( config.adaptive_rto ) {
+      rtt_estimator_.emplace( config.min_rto_ms, config.max_rto_ms );
+      timer.setMaxRTO( config.max_rto_ms );
+    }
+    fast_retransmit_ = config.fast_retransmit or config.sack;
+    sack_ = config.sack;
+    repacketize_ = config.repacketize;
+    nagle_ = config.nagle;
+    hold_timeout_ms_ = config.hold_timeout_ms;
+    if ( config.pacing ) {
+      pacer_.emplace( TCPConfig::PACING_BURST_SEGMENTS * mss_ );
+      pacing_rate_ = config.pacing_rate;
+    }
+  }
 
   /* Generate an empty TCPSenderMessage */
   TCPSenderMessage make_empty_message() const;
@@ -47,13 +123,35 @@ public:
   /* Time has passed by the given # of milliseconds since the last time the tick() method was called */
   void tick( uint64_t ms_since_last_tick, const TransmitFunction& transmit );
 
+  /* The peer's SYN carried an MSS option: send no more than `mss` bytes of payload in a segment */
+  void set_peer_mss( uint64_t mss );
+
+  /* The peer's SYN carried no window scale option: if ours hasn't gone out yet, it answers that SYN and
+     mustn't offer one either (RFC 7323 section 1.3) */
+  void decline_window_scale();
+
+  /* Like TCP_CORK: send only full-sized segments until uncork(), which sends whatever is left */
+  void cork() { corked_ = true; }
+  void uncork( const TransmitFunction& transmit );
+  bool corked() const { return corked_; }
+
   // Accessors
   uint64_t sequence_numbers_in_flight() const;  // How many sequence numbers are outstanding?
   uint64_t consecutive_retransmissions() const; // How many consecutive retransmissions have happened?
+  uint64_t current_RTO_ms() const;              // Retransmission timeout in effect, including backoff
+  std::optional<uint64_t> srtt_ms() const;      // Smoothed RTT (only with TCPConfig::adaptive_rto)
+  // How long until tick() can send segments that are being held back, by the pacer (TCPConfig::pacing) or
+  // until the hold timeout (nagle or cork); none if nothing is. An event loop can sleep until then.
+  std::optional<uint64_t> ms_until_next_send() const;
+  bool in_fast_recovery() const { return recover_.has_value(); }
+  uint64_t mss() const { return mss_; } // Largest payload in a segment (other than a path MTU probe)
   const Writer& writer() const { return input_.writer(); }
   const Reader& reader() const { return input_.reader(); }
   Writer& writer() { return input_.writer(); }
 
+  // The congestion control algorithm, or nullptr if sending is limited only by the receiver's window
+  const CongestionControl* congestion_control() const { return congestion_control_.get(); }
+
 private:
   Reader& reader() { return input_.reader(); }
 
@@ -63,7 +161,89 @@ private:
 
   bool isSYN { false }, isFIN { false };
   uint64_t outstanding_count {}, retransmissions_count { 0 }, window_size { 1 }, ackno_ { 0 }, sentno_ { 0 };
-  std::queue<TCPSenderMessage> outstanding_message_;
+  // A sent segment waiting to be acknowledged. Its payload is kept by the input stream (retained after being
+  // popped, until acknowledged), so a retransmission is rebuilt from there.
+  struct Outstanding
+  {
+    uint64_t seqno;     // absolute sequence number of its first sequence number
+    uint64_t length;    // payload bytes
+    bool SYN, FIN;      // flags it carries
+    uint64_t sent_ms;   // when it was (first) sent
+    bool retransmitted; // if so, its ack can't be used to measure the RTT (Karn's rule)
+    bool sacked {};     // the receiver holds it (selectively acknowledged)
+    bool lost {};       // deemed lost and waiting to be retransmitted
+    bool probe {};      // a path MTU probe, larger than mss_
+
+    uint64_t sequence_length() const { return SYN + length + FIN; }
+  };
+  std::deque<Outstanding> outstanding_message_;
+
+  TCPSenderMessage make_message( const Outstanding& segment ) const; // Rebuild a segment from the stream.
+  void coalesce( size_t index ); // Merge the segments after `index` into it, up to one MSS (repacketization).
+  void retransmit( size_t index, const TransmitFunction& transmit );
+  void split( size_t index ); // Cut a segment larger than mss_ into ones of at most mss_.
+  bool repacketize_ {}; // coalesce() and trimming partially acknowledged segments (TCPConfig::repacketize)
 
   Timer timer;
+
+  std::unique_ptr<CongestionControl> congestion_control_ {};
+  std::optional<RTTEstimator> rtt_estimator_ {};
+
+  // Fast retransmit and NewReno fast recovery (RFC 5681, RFC 6582), with limited transmit (RFC 3042)
+  static constexpr uint64_t DUP_ACK_THRESHOLD = 3;
+  bool fast_retransmit_ {};
+  bool retransmit_pending_ {};          // retransmit the first outstanding segment on the next push()
+  uint64_t dup_acks_ {};                // duplicate acks since the last ack of new data
+  std::optional<uint64_t> recover_ {};  // in fast recovery until this absolute seqno is acknowledged
+  uint64_t recover_point_ {};           // RFC 6582's "recover": set on recovery or timeout, and duplicate acks
+                                        // start fast recovery only once the ackno has reached it again
+  uint64_t window_inflation_ {};        // extra room in the congestion window during fast recovery
+
+  // SACK scoreboard (RFC 6675): the segments the receiver reported holding, and the holes below them
+  bool sack_ {};
+  bool sack_seen_ {};        // the receiver has sent SACK blocks, so recovery follows the scoreboard
+  uint64_t sacked_count_ {}; // sequence numbers in `sacked` segments
+  uint64_t lost_count_ {};   // sequence numbers in `lost` segments
+
+  void update_scoreboard( const TCPReceiverMessage& msg );
+  void mark_lost( Outstanding& segment );
+  uint64_t pipe() const; // Sequence numbers estimated to still be in the network
+  void enter_recovery();
+  void retransmit_lost( const TransmitFunction& transmit );
+
+  void on_duplicate_ack();
+  void on_new_ack( uint64_t acked_bytes, std::optional<uint64_t> rtt_ms );
+  uint64_t now_ms_ {}; // total time passed to tick()
+
+  uint64_t send_room() const; // How many more sequence numbers may be sent now?
+
+  // Pacing: push() stops when the pacer runs out of tokens, and tick() sends the rest as they accrue
+  std::optional<Pacer> pacer_ {};
+  uint64_t pacing_rate_ {}; // bytes per second (0: derived from the congestion window and SRTT)
+  bool paced_ {};           // push() left sendable data behind because of the pacer
+  void update_pacing_rate();
+
+  // Nagle, cork and sender-side silly window avoidance: push() holds back small segments, for up to
+  // hold_timeout_ms_
+  bool nagle_ {}, corked_ {};
+  bool flush_ {};                          // send what is held back (on uncork or when the hold times out)
+  uint64_t max_window_ {};                 // largest window the receiver has offered
+  uint64_t hold_timeout_ms_ {};
+  std::optional<uint64_t> held_since_ms_ {}; // when push() started holding data back
+  bool hold_back( uint64_t room ) const;   // Should push() wait rather than send a small segment now?
+  void flush( const TransmitFunction& transmit );
+
+  // Segment size, and packetization-layer path MTU discovery (RFC 4821): a binary search between mss_ (known
+  // to get through) and search_high_, one probe segment at a time
+  static constexpr uint64_t PROBE_THRESHOLD = 8;     // stop searching this close (Linux's tcp_probe_threshold)
+  static constexpr uint64_t BLACK_HOLE_TIMEOUTS = 3; // timeouts in a row that suggest the path MTU shrank
+  uint64_t mss_ { TCPConfig::MAX_PAYLOAD_SIZE };
+  uint16_t advertised_mss_ {}; // in the SYN's MSS option (0: none)
+  std::optional<uint8_t> window_scale_ {}; // in the SYN's window scale option (none: not offered)
+  bool mtu_probing_ {};
+  uint64_t base_mss_ {};    // where the search started, to fall back to
+  uint64_t search_high_ {}; // largest payload that might get through
+  uint64_t probe_size_ {};  // payload of the probe in flight (0: none)
+  uint64_t next_probe_size() const; // 0: don't probe now
+  void set_mss( uint64_t mss );
 };
@@ -0,0 +1,221 @@
+#pragma once
+
+// Helpers shared by the *_bench programs: allocation counting, percentiles over repeated runs,
+// and CSV or JSON output. This header replaces the global operator new, so include it from
+// exactly one translation unit per program.
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+inline std::atomic<uint64_t> allocation_count {};
+
+// Number of heap allocations made by the program so far
+inline uint64_t allocations()
+{
+  return allocation_count.load( std::memory_order_relaxed );
+}
+
+// One timed run of a benchmark
+struct Sample
+{
+  double seconds {};
+  uint64_t bytes {};       // payload bytes moved
+  uint64_t ops {};         // calls into the structure under test
+  uint64_t allocations {}; // heap allocations made during the run
+
+  double gbit_per_second() const { return 8 * static_cast<double>( bytes ) / seconds / 1e9; }
+  double ns_per_op() const { return ops ? seconds * 1e9 / static_cast<double>( ops ) : 0; }
+  double allocations_per_op() const
+  {
+    return ops ? static_cast<double>( allocations ) / static_cast<double>( ops ) : 0;
+  }
+};
+
+// Nearest-rank percentile (`p` in [0, 100]) of `values`
+inline double percentile( std::vector<double> values, double p )
+{
+  if ( values.empty() ) {
+    return 0;
+  }
+  std::ranges::sort( values );
+  const auto rank = static_cast<size_t>( std::ceil( p / 100 * static_cast<double>( values.size() ) ) );
+  return values.at( std::clamp( rank, size_t { 1 }, values.size() ) - 1 );
+}
+
+struct Options
+{
+  enum class Format : uint8_t
+  {
+    CSV,
+    JSON
+  };
+
+  Format format { Format::CSV };
+  size_t repeat { 7 };      // timed runs per configuration
+  size_t bytes { 1 << 22 }; // payload per run
+  bool quick {};            // sweep a reduced set of configurations
+
+  static Options parse( std::span<char*> args, std::string_view extra_usage = {} )
+  {
+    Options options;
+    for ( size_t i = 1; i < args.size(); i++ ) {
+      const std::string_view arg { args[i] };
+      const auto value = [&]( std::string_view prefix ) { return std::string { arg.substr( prefix.size() ) }; };
+      if ( arg == "--format=csv" ) {
+        options.format = Format::CSV;
+      } else if ( arg == "--format=json" ) {
+        options.format = Format::JSON;
+      } else if ( arg.starts_with( "--repeat=" ) ) {
+        options.repeat = std::max( std::stoul( value( "--repeat=" ) ), 1UL );
+      } else if ( arg.starts_with( "--bytes=" ) ) {
+        options.bytes = std::max( std::stoul( value( "--bytes=" ) ), 1UL );
+      } else if ( arg == "--quick" ) {
+        options.quick = true;
+      } else {
+        std::cerr << "Usage: " << args.front()
+                  << " [--format=csv|json] [--repeat=N] [--bytes=N] [--quick]" << extra_usage << "\n";
+        throw std::runtime_error( "unrecognized option " + std::string { arg } );
+      }
+    }
+    return options;
+  }
+};
+
+// Collects one row per configuration (its parameters plus a summary of its samples) and prints them.
+class Report
+{
+public:
+  using Params = std::vector<std::pair<std::string, std::string>>;
+
+  Report( std::string name, const Options& options ) : name_( std::move( name ) ), options_( options ) {}
+
+  // `extra` holds benchmark-specific results, printed after the common ones.
+  void add( Params params, const std::vector<Sample>& samples, const Params& extra = {} )
+  {
+    std::vector<double> gbps, ns, allocs;
+    for ( const auto& s : samples ) {
+      gbps.push_back( s.gbit_per_second() );
+      ns.push_back( s.ns_per_op() );
+      allocs.push_back( s.allocations_per_op() );
+    }
+
+    params.emplace_back( "bytes", std::to_string( samples.empty() ? 0 : samples.front().bytes ) );
+    params.emplace_back( "repeat", std::to_string( samples.size() ) );
+    params.emplace_back( "gbps_p50", fmt( percentile( gbps, 50 ) ) );
+    params.emplace_back( "gbps_min", fmt( percentile( gbps, 0 ) ) );
+    params.emplace_back( "gbps_max", fmt( percentile( gbps, 100 ) ) );
+    params.emplace_back( "ns_per_op_p10", fmt( percentile( ns, 10 ) ) );
+    params.emplace_back( "ns_per_op_p50", fmt( percentile( ns, 50 ) ) );
+    params.emplace_back( "ns_per_op_p90", fmt( percentile( ns, 90 ) ) );
+    params.emplace_back( "allocs_per_op", fmt( percentile( allocs, 50 ) ) );
+    params.insert( params.end(), extra.begin(), extra.end() );
+    rows_.push_back( std::move( params ) );
+  }
+
+  static std::string fmt( double value )
+  {
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision( 4 ) << value;
+    return ss.str();
+  }
+
+  void print( std::ostream& out ) const
+  {
+    if ( options_.format == Options::Format::CSV ) {
+      print_csv( out );
+    } else {
+      print_json( out );
+    }
+  }
+
+private:
+  std::string name_;
+  Options options_;
+  std::vector<Params> rows_ {};
+
+  static bool numeric( const std::string& value )
+  {
+    return not value.empty() and value.find_first_not_of( "0123456789.-" ) == std::string::npos;
+  }
+
+  void print_csv( std::ostream& out ) const
+  {
+    if ( rows_.empty() ) {
+      return;
+    }
+    out << "benchmark";
+    for ( const auto& [key, value] : rows_.front() ) {
+      out << "," << key;
+    }
+    out << "\n";
+    for ( const auto& row : rows_ ) {
+      out << name_;
+      for ( const auto& [key, value] : row ) {
+        out << "," << value;
+      }
+      out << "\n";
+    }
+  }
+
+  void print_json( std::ostream& out ) const
+  {
+    out << "{\"benchmark\": \"" << name_ << "\", \"results\": [";
+    for ( size_t i = 0; i < rows_.size(); i++ ) {
+      out << ( i ? ",\n  {" : "\n  {" );
+      for ( size_t j = 0; j < rows_[i].size(); j++ ) {
+        const auto& [key, value] = rows_[i][j];
+        out << ( j ? ", " : "" ) << "\"" << key << "\": ";
+        if ( numeric( value ) ) {
+          out << value;
+        } else {
+          out << "\"" << value << "\"";
+        }
+      }
+      out << "}";
+    }
+    out << "\n]}\n";
+  }
+};
+
+} // namespace bench
+
+// Count every heap allocation (sized and unsized deletes fall through to free()).
+// GCC can't see that these replacements pair malloc() with free(), hence the pragma.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void* operator new( size_t size )
+{
+  bench::allocation_count.fetch_add( 1, std::memory_order_relaxed );
+  if ( void* ptr = std::malloc( size ? size : 1 ) ) {
+    return ptr;
+  }
+  throw std::bad_alloc {};
+}
+
+void operator delete( void* ptr ) noexcept
+{
+  std::free( ptr ); // NOLINT(*-no-malloc)
+}
+
+void operator delete( void* ptr, size_t /* size */ ) noexcept
+{
+  std::free( ptr ); // NOLINT(*-no-malloc)
+}
+
+#pragma GCC diagnostic pop
@@ -0,0 +1,217 @@
+#include "bench.hh"
+#include "byte_stream.hh"
+#include "concurrent_byte_stream.hh"
+
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <thread>
+
+using namespace std;
+using namespace std::chrono;
+
+// Sweeps ByteStream (and ConcurrentByteStream) over capacity, write size, read size and the
+// interleaving of producer and consumer, and reports throughput, ns per call and allocations
+// per call as CSV or JSON (see bench.hh). Not part of the test suite: run it by hand, e.g.
+//     ./tests/byte_stream_bench --format=json > byte_stream.json
+
+namespace {
+
+using bench::Sample;
+
+enum class Interleaving : uint8_t
+{
+  Lockstep, // one write, then one read, per iteration
+  Burst,    // fill the stream to capacity, then drain it completely
+  Threads,  // ConcurrentByteStream with the writer and reader on separate threads
+};
+
+string_view to_string( Interleaving mode )
+{
+  switch ( mode ) {
+    case Interleaving::Lockstep:
+      return "lockstep";
+    case Interleaving::Burst:
+      return "burst";
+    case Interleaving::Threads:
+      return "threads";
+  }
+  return "?";
+}
+
+struct Config
+{
+  Interleaving mode;
+  uint64_t capacity;
+  size_t write_size;
+  size_t read_size;
+};
+
+string make_data( size_t len )
+{
+  default_random_engine rd { 789 };
+  uniform_int_distribution<char> ud;
+  string ret( len, 0 );
+  ranges::generate( ret, [&] { return ud( rd ); } );
+  return ret;
+}
+
+// Check what was read against the input as it goes, so the output needn't be stored.
+void consume( string_view data, uint64_t& offset, string_view peeked )
+{
+  if ( peeked.empty() ) {
+    throw runtime_error( "peek() returned empty view" );
+  }
+  if ( memcmp( data.data() + offset, peeked.data(), peeked.size() ) != 0 ) {
+    throw runtime_error( "Mismatch between data written and read" );
+  }
+  offset += peeked.size();
+}
+
+Sample run_single_threaded( const Config& config, string_view data )
+{
+  ByteStream bs { config.capacity };
+  Writer& writer = bs.writer();
+  Reader& reader = bs.reader();
+  uint64_t written = 0, read = 0, ops = 0;
+
+  const auto write_once = [&] {
+    const size_t len = min( config.write_size, data.size() - written );
+    if ( len == 0 or writer.available_capacity() < len ) {
+      return false;
+    }
+    writer.push( string { data.substr( written, len ) } );
+    written += len;
+    ops++;
+    return true;
+  };
+
+  const auto read_once = [&] {
+    if ( reader.bytes_buffered() == 0 ) {
+      return false;
+    }
+    const auto peeked = reader.peek().substr( 0, config.read_size );
+    consume( data, read, peeked );
+    reader.pop( peeked.size() );
+    ops++;
+    return true;
+  };
+
+  const uint64_t allocations_before = bench::allocations();
+  const auto start_time = steady_clock::now();
+  while ( read < data.size() ) {
+    if ( config.mode == Interleaving::Lockstep ) {
+      write_once();
+      read_once();
+    } else {
+      while ( write_once() ) {}
+      while ( read_once() ) {}
+    }
+  }
+  const auto stop_time = steady_clock::now();
+
+  return { duration_cast<duration<double>>( stop_time - start_time ).count(),
+           data.size(),
+           ops,
+           bench::allocations() - allocations_before };
+}
+
+Sample run_threads( const Config& config, string_view data )
+{
+  ConcurrentByteStream bs { config.capacity };
+  uint64_t read = 0, reader_ops = 0;
+  atomic<uint64_t> writer_ops = 0;
+
+  const uint64_t allocations_before = bench::allocations();
+  const auto start_time = steady_clock::now();
+  thread producer { [&] {
+    uint64_t written = 0, ops = 0;
+    while ( written < data.size() ) {
+      const size_t len = min( config.write_size, data.size() - written );
+      if ( bs.writer().available_capacity() < len ) {
+        this_thread::yield();
+        continue;
+      }
+      bs.writer().push( string { data.substr( written, len ) } );
+      written += len;
+      ops++;
+    }
+    bs.writer().close();
+    writer_ops = ops;
+  } };
+
+  while ( not bs.reader().is_finished() ) {
+    const auto peeked = bs.reader().peek().substr( 0, config.read_size );
+    if ( peeked.empty() ) {
+      this_thread::yield();
+      continue;
+    }
+    consume( data, read, peeked );
+    bs.reader().pop( peeked.size() );
+    reader_ops++;
+  }
+  producer.join();
+  const auto stop_time = steady_clock::now();
+
+  if ( read != data.size() ) {
+    throw runtime_error( "ConcurrentByteStream finished early" );
+  }
+
+  return { duration_cast<duration<double>>( stop_time - start_time ).count(),
+           data.size(),
+           reader_ops + writer_ops,
+           bench::allocations() - allocations_before };
+}
+
+void program_body( const bench::Options& options )
+{
+  const string data = make_data( options.bytes );
+  bench::Report report { "byte_stream", options };
+
+  const vector<uint64_t> capacities = options.quick ? vector<uint64_t> { 65536 }
+                                                    : vector<uint64_t> { 4096, 65536, 1 << 20, 16 << 20 };
+  const vector<size_t> write_sizes = options.quick ? vector<size_t> { 1500 } : vector<size_t> { 64, 1500, 16384 };
+  const vector<size_t> read_sizes
+    = options.quick ? vector<size_t> { 128, 4096 } : vector<size_t> { 32, 1500, 65536 };
+
+  for ( const auto mode : { Interleaving::Lockstep, Interleaving::Burst, Interleaving::Threads } ) {
+    for ( const auto capacity : capacities ) {
+      for ( const auto write_size : write_sizes ) {
+        for ( const auto read_size : read_sizes ) {
+          if ( write_size > capacity ) {
+            continue;
+          }
+          const Config config { mode, capacity, write_size, read_size };
+          vector<Sample> samples;
+          for ( size_t i = 0; i < options.repeat; i++ ) {
+            samples.push_back( mode == Interleaving::Threads ? run_threads( config, data )
+                                                             : run_single_threaded( config, data ) );
+          }
+          report.add( { { "interleaving", string { to_string( mode ) } },
+                        { "capacity", std::to_string( capacity ) },
+                        { "write_size", std::to_string( write_size ) },
+                        { "read_size", std::to_string( read_size ) } },
+                      samples );
+        }
+      }
+    }
+  }
+
+  report.print( cout );
+}
+} // namespace
+
+int main( int argc, char** argv )
+{
+  try {
+    if ( argc <= 0 ) {
+      abort();
+    }
+    program_body( bench::Options::parse( { argv, static_cast<size_t>( argc ) } ) );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -67,6 +67,7 @@ int main()
       test.execute( AvailableCapacity { 0 } );
       test.execute( BytesBuffered { 2 } );
       test.execute( Peek { "at" } );
+      test.execute( PeekIov { "at" } );
     }
 
     {
@@ -0,0 +1,184 @@
+#include "concurrent_byte_stream.hh"
+#include "exception.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <poll.h>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+
+namespace {
+string random_bytes( size_t len, unsigned int seed )
+{
+  default_random_engine rd { seed };
+  uniform_int_distribution<char> ud;
+  string ret( len, '\0' );
+  for ( auto& c : ret ) {
+    c = ud( rd );
+  }
+  return ret;
+}
+
+// Sleep until `event` fires. A wakeup that never comes would hang the test, so give up after five seconds.
+void wait_for( EventFD& event, const string& what )
+{
+  pollfd pfd { .fd = event.fd_num(), .events = POLLIN, .revents = 0 };
+  if ( CheckSystemCall( "poll", ::poll( &pfd, 1, 5000 ) ) == 0 ) {
+    throw runtime_error( what + " was never woken up" );
+  }
+}
+
+// Run `body` on a thread of its own; join() rethrows anything it threw.
+class WriterThread
+{
+  exception_ptr error_ {};
+  jthread thread_;
+
+public:
+  explicit WriterThread( const function<void()>& body )
+    : thread_( [this, body] {
+      try {
+        body();
+      } catch ( ... ) {
+        error_ = current_exception();
+      }
+    } )
+  {}
+
+  void join()
+  {
+    thread_.join();
+    if ( error_ ) {
+      rethrow_exception( error_ );
+    }
+  }
+};
+
+// The reader drains `stream` in pieces of up to `read_size` bytes (sleeping `read_delay` before each),
+// waiting on readable_event() whenever it finds the stream empty.
+string drain( ConcurrentByteStream& stream, size_t read_size, chrono::microseconds read_delay )
+{
+  ConcurrentReader& reader = stream.reader();
+  string output;
+  while ( true ) {
+    stream.readable_event().clear();
+    if ( reader.is_finished() ) {
+      return output;
+    }
+    if ( reader.bytes_buffered() == 0 ) {
+      wait_for( stream.readable_event(), "the reader" );
+      continue;
+    }
+    this_thread::sleep_for( read_delay );
+    const string_view view = reader.peek().substr( 0, read_size );
+    output += view;
+    reader.pop( view.size() );
+  }
+}
+
+// One thread writes `data` (through push() and reserve()/commit(), in random sizes) while another reads it
+// (in random sizes), each sleeping on its eventfd whenever it can make no progress. Every byte must arrive,
+// in order.
+void transfer_test( const string& data, uint64_t capacity, unsigned int seed )
+{
+  ConcurrentByteStream stream { capacity, true };
+
+  WriterThread writer_thread( [&] {
+    ConcurrentWriter& writer = stream.writer();
+    default_random_engine rd { seed };
+    uniform_int_distribution<uint64_t> write_size { 1, capacity * 2 };
+    uint64_t written = 0;
+    while ( written < data.size() ) {
+      stream.writable_event().clear();
+      const uint64_t len = min( write_size( rd ), data.size() - written );
+      if ( rd() % 2 ) {
+        const uint64_t before = writer.bytes_pushed();
+        writer.push( data.substr( written, len ) );
+        written += writer.bytes_pushed() - before;
+      } else {
+        const span<char> space = writer.reserve( len );
+        memcpy( space.data(), data.data() + written, space.size() );
+        writer.commit( space.size() );
+        written += space.size();
+      }
+      if ( writer.available_capacity() == 0 ) {
+        wait_for( stream.writable_event(), "the writer" );
+      }
+    }
+    writer.close();
+  } );
+
+  default_random_engine rd { seed + 1 };
+  const string output = drain( stream, uniform_int_distribution<size_t> { 1, capacity }( rd ), {} );
+  writer_thread.join();
+
+  if ( output != data ) {
+    throw runtime_error( "reader received " + to_string( output.size() ) + " of " + to_string( data.size() )
+                         + " bytes (or the wrong bytes)" );
+  }
+}
+
+// The writer pushes fixed-size records, each all at once, so it sleeps whenever less than a record's worth of
+// space is free, even though the stream is not full. Each pop() must still wake it up.
+void partial_space_wakeup_test()
+{
+  constexpr uint64_t capacity = 100;
+  constexpr size_t record_size = 70;
+  constexpr size_t records = 200;
+  const string data = random_bytes( record_size * records, 17 );
+  ConcurrentByteStream stream { capacity, true };
+
+  atomic<uint64_t> waits {};
+  WriterThread writer_thread( [&] {
+    ConcurrentWriter& writer = stream.writer();
+    for ( size_t i = 0; i < records; ) {
+      stream.writable_event().clear();
+      if ( writer.available_capacity() >= record_size ) {
+        writer.push( data.substr( i * record_size, record_size ) );
+        ++i;
+        continue;
+      }
+      writer.reserve( record_size ); // comes up short, so the next pop() will wake us
+      if ( writer.available_capacity() < record_size ) {
+        ++waits;
+        wait_for( stream.writable_event(), "the writer (waiting for a record's worth of space)" );
+      }
+    }
+    stream.writer().close();
+  } );
+
+  // popping seven bytes at a time, the stream is never full when the writer starts waiting
+  const string output = drain( stream, 7, chrono::microseconds( 20 ) );
+  writer_thread.join();
+
+  if ( output != data ) {
+    throw runtime_error( "reader received the wrong records" );
+  }
+  if ( waits == 0 ) {
+    throw runtime_error( "the writer never had to wait" );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    transfer_test( random_bytes( 5000, 1 ), 1, 2 );
+    transfer_test( random_bytes( 1 << 20, 3 ), 4096, 4 );
+    transfer_test( random_bytes( 1 << 20, 5 ), 65000, 6 );
+    partial_space_wakeup_test();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,110 @@
+#include "byte_stream.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+// The byte at stream position `index`
+char expected_byte( uint64_t index )
+{
+  return static_cast<char>( ( index * 2654435761U ) >> 13U );
+}
+
+void fill( span<char> space, uint64_t first_index )
+{
+  for ( size_t i = 0; i < space.size(); ++i ) {
+    space[i] = expected_byte( first_index + i );
+  }
+}
+
+void check( span<const string_view> views, uint64_t first_index, uint64_t len, const string& what )
+{
+  uint64_t index = first_index;
+  for ( const auto& view : views ) {
+    for ( const char c : view ) {
+      if ( index == first_index + len ) {
+        return;
+      }
+      if ( c != expected_byte( index ) ) {
+        ostringstream ss;
+        ss << what << ": stream byte " << index << " was " << static_cast<int>( c ) << ", expected "
+           << static_cast<int>( expected_byte( index ) );
+        throw runtime_error( ss.str() );
+      }
+      ++index;
+    }
+  }
+  if ( index != first_index + len ) {
+    throw runtime_error( what + ": views were too short" );
+  }
+}
+
+// Random pushes (some through reserve()/commit(), held across pops), peeks, pops and releases on a stream
+// large enough to use the MappedRingBuffer, checking every byte as it is popped and again as it is released.
+void mapped_stress_test( uint64_t capacity, uint64_t total, unsigned int seed )
+{
+  default_random_engine rd { seed };
+  // pushes outpace pops, so the stream runs nearly full and the Writer wraps right behind the Reader
+  uniform_int_distribution<uint64_t> push_chunk { 0, capacity / 2 };
+  uniform_int_distribution<uint64_t> chunk { 0, capacity / 4 };
+  uniform_int_distribution<int> coin { 0, 3 };
+
+  ByteStream stream { capacity };
+  stream.set_retain_popped( true );
+  Writer& writer = stream.writer();
+  Reader& reader = stream.reader();
+
+  while ( reader.bytes_popped() < total ) {
+    // write, either with push() or into reserved space that is only filled after the next read
+    span<char> reserved {};
+    const uint64_t to_push = min( push_chunk( rd ), total - writer.bytes_pushed() );
+    if ( coin( rd ) == 0 ) {
+      string data( min( to_push, writer.available_capacity() ), '\0' );
+      fill( { data.data(), data.size() }, writer.bytes_pushed() );
+      writer.push( move( data ) );
+    } else {
+      reserved = writer.reserve( to_push );
+    }
+
+    // read
+    const uint64_t to_pop = min( chunk( rd ), reader.bytes_buffered() );
+    check( reader.peek_iov(), reader.bytes_popped(), to_pop, "popped" );
+    reader.pop( to_pop );
+
+    const uint64_t to_release = min( chunk( rd ), reader.bytes_retained() );
+    const uint64_t oldest = reader.bytes_popped() - reader.bytes_retained();
+    check( reader.peek_retained( 0, to_release ), oldest, to_release, "released" );
+    reader.release( to_release );
+
+    if ( not reserved.empty() ) {
+      const uint64_t committed = reserved.size() - reserved.size() / ( coin( rd ) + 2 );
+      fill( reserved.first( committed ), writer.bytes_pushed() );
+      writer.commit( committed );
+    }
+  }
+
+  if ( writer.bytes_pushed() != total ) {
+    throw runtime_error( "unexpected number of bytes pushed" );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    constexpr uint64_t capacity = ByteStream::MAPPED_BUFFER_THRESHOLD;
+    mapped_stress_test( capacity, 5 * capacity + 12345, 10110 );
+    mapped_stress_test( capacity + 1000, 4 * capacity, 98765 );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,77 @@
+#include "byte_stream_test_harness.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main()
+{
+  try {
+    {
+      ByteStreamTestHarness test { "partial commit", 10 };
+
+      test.execute( ReserveAndCommit { 8, "abc", 8 } );
+      test.execute( BytesPushed { 3 } );
+      test.execute( BytesBuffered { 3 } );
+      test.execute( AvailableCapacity { 7 } );
+      test.execute( Peek { "abc" } );
+      test.execute( ReserveAndCommit { 10, "defg", 7 } );
+      test.execute( ReserveAndCommit { 3, "", 3 } ); // reserved, but nothing written
+      test.execute( BytesPushed { 7 } );
+      test.execute( AvailableCapacity { 3 } );
+      test.execute( Peek { "abcdefg" } );
+      test.execute( Pop { 2 } );
+      test.execute( ReserveAndCommit { 5, "h", 3 } ); // up to the end of the ring
+      test.execute( Peek { "cdefgh" } );
+    }
+
+    {
+      ByteStreamTestHarness test { "commit across the ring's wrap point", 8 };
+
+      test.execute( Push { "abcdef" } );
+      test.execute( Pop { 4 } );
+      test.execute( ReserveAndCommit { 5, "gh", 2 } ); // stops at the end of the ring
+      test.execute( ReserveAndCommit { 5, "ijk", 4 } ); // continues at its start
+      test.execute( BytesPushed { 11 } );
+      test.execute( AvailableCapacity { 1 } );
+      test.execute( PeekOnce { "efgh" } );
+      test.execute( PeekIov { "efghijk" } );
+      test.execute( CommitRejected { 2 } );
+      test.execute( Peek { "efghijk" } );
+      test.execute( Pop { 5 } );
+      test.execute( ReserveAndCommit { 8, "lmnop", 5 } );
+      test.execute( ReserveAndCommit { 8, "q", 1 } );
+      test.execute( AvailableCapacity { 0 } );
+      test.execute( PeekIov { "jklmnopq" } );
+    }
+
+    {
+      ByteStreamTestHarness test { "reserve with no capacity", 0 };
+
+      test.execute( ReserveAndCommit { 1, "", 0 } );
+      test.execute( ReserveAndCommit { 0, "", 0 } );
+      test.execute( CommitRejected { 1 } );
+      test.execute( BytesPushed { 0 } );
+      test.execute( BytesBuffered { 0 } );
+      test.execute( Close {} );
+      test.execute( IsFinished { true } );
+    }
+
+    {
+      ByteStreamTestHarness test { "reserve on a full stream", 4 };
+
+      test.execute( Push { "abcd" } );
+      test.execute( ReserveAndCommit { 1, "", 0 } );
+      test.execute( CommitRejected { 1 } );
+      test.execute( Pop { 1 } );
+      test.execute( ReserveAndCommit { 2, "e", 1 } );
+      test.execute( Peek { "bcde" } );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,62 @@
+#include "byte_stream_test_harness.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main()
+{
+  try {
+    {
+      ByteStreamTestHarness test { "retained bytes stay until released", 8 };
+
+      test.execute( SetRetainPopped { true } );
+      test.execute( Push { "abcdef" } );
+      test.execute( Pop { 4 } );
+      test.execute( BytesBuffered { 2 } );
+      test.execute( BytesRetained { 4 } );
+      test.execute( AvailableCapacity { 2 } );
+      test.execute( PeekRetained { 1, 2, "bc" } );
+      test.execute( PeekRetained { 0, 10, "abcd" } );
+      test.execute( Peek { "ef" } );
+      test.execute( Release { 3 } );
+      test.execute( BytesRetained { 1 } );
+      test.execute( AvailableCapacity { 5 } );
+      test.execute( PeekRetained { 0, 1, "d" } );
+    }
+
+    {
+      ByteStreamTestHarness test { "retained bytes survive wrapping and growth", 10000 };
+
+      test.execute( SetRetainPopped { true } );
+      test.execute( Push { string( 4090, 'x' ) } );
+      test.execute( Pop { 4090 } );
+      test.execute( Release { 4080 } );
+      test.execute( Push { "0123456789" } ); // wraps around the end of a 4096-byte ring
+      test.execute( Pop { 10 } );
+      test.execute( PeekRetained { 8, 12, "xx0123456789" } );
+      test.execute( Push { string( 5000, 'y' ) } ); // grows the ring
+      test.execute( PeekRetained { 8, 12, "xx0123456789" } );
+      test.execute( Peek { string( 5000, 'y' ) } );
+      test.execute( Release { 20 } );
+      test.execute( BytesRetained { 0 } );
+      test.execute( AvailableCapacity { 5000 } );
+    }
+
+    {
+      ByteStreamTestHarness test { "popped bytes are freed without retention", 8 };
+
+      test.execute( Push { "abcdef" } );
+      test.execute( Pop { 4 } );
+      test.execute( BytesRetained { 0 } );
+      test.execute( AvailableCapacity { 6 } );
+      test.execute( PeekRetained { 0, 4, "" } );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
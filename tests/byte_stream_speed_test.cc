@@ -1,4 +1,5 @@
 #include "byte_stream.hh"
+#include "concurrent_byte_stream.hh"
 
 #include <chrono>
 #include <cstddef>
@@ -7,6 +8,7 @@
 #include <iostream>
 #include <queue>
 #include <random>
+#include <thread>
 
 using namespace std;
 using namespace std::chrono;
@@ -89,6 +91,83 @@ double speed_test( fstream& debug_output,
   return gigabits_per_second;
 }
 
+// Same workload as speed_test(), but the writer and reader run on separate threads
+// and share a ConcurrentByteStream.
+double concurrent_speed_test( fstream& debug_output,
+                              const size_t input_len,   // NOLINT(bugprone-easily-swappable-parameters)
+                              const size_t capacity,    // NOLINT(bugprone-easily-swappable-parameters)
+                              const size_t random_seed, // NOLINT(bugprone-easily-swappable-parameters)
+                              const size_t write_size,  // NOLINT(bugprone-easily-swappable-parameters)
+                              const size_t read_size )  // NOLINT(bugprone-easily-swappable-parameters)
+{
+  const string data = [&random_seed, &input_len] {
+    default_random_engine rd { random_seed };
+    uniform_int_distribution<char> ud;
+    string ret;
+    for ( size_t i = 0; i < input_len; ++i ) {
+      ret += ud( rd );
+    }
+    return ret;
+  }();
+
+  queue<string> split_data;
+  for ( size_t i = 0; i < data.size(); i += write_size ) {
+    split_data.emplace( data.substr( i, write_size ) );
+  }
+
+  ConcurrentByteStream bs { capacity };
+  string output_data;
+  output_data.reserve( data.size() );
+
+  const auto start_time = steady_clock::now();
+  thread producer { [&] {
+    while ( not split_data.empty() ) {
+      if ( split_data.front().size() <= bs.writer().available_capacity() ) {
+        bs.writer().push( move( split_data.front() ) );
+        split_data.pop();
+      } else {
+        this_thread::yield();
+      }
+    }
+    bs.writer().close();
+  } };
+
+  while ( not bs.reader().is_finished() ) {
+    auto peeked = bs.reader().peek().substr( 0, read_size );
+    if ( peeked.empty() ) {
+      this_thread::yield();
+      continue;
+    }
+    output_data += peeked;
+    bs.reader().pop( peeked.size() );
+  }
+
+  const auto stop_time = steady_clock::now();
+  producer.join();
+
+  if ( data != output_data ) {
+    throw runtime_error( "Mismatch between data written and read (ConcurrentByteStream)" );
+  }
+
+  auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  auto gigabits_per_second = 8 * static_cast<double>( input_len ) / test_duration.count() / 1e9;
+
+  cout << "ConcurrentByteStream with capacity=" << capacity << ", write_size=" << write_size
+       << ", read_size=" << read_size << " reached " << fixed << setprecision( 2 ) << gigabits_per_second
+       << " Gbit/s (two threads).\n";
+
+  auto read_s = to_string( read_size );
+  const string fill( 5 - read_s.size(), ' ' );
+  debug_output << "        ConcurrentByteStream throughput, two threads (pop length " << read_s << "):" << fill
+               << fixed << setprecision( 2 ) << setw( 5 ) << gigabits_per_second << " Gbit/s\n";
+
+  if ( gigabits_per_second < 0.1 ) {
+    throw runtime_error( "ConcurrentByteStream did not meet minimum speed of 0.1 Gbit/s" );
+  }
+
+  return gigabits_per_second;
+}
+
 void program_body()
 {
   fstream debug_output;
@@ -97,6 +176,9 @@ void program_body()
   speed_test( debug_output, 1e7, 32768, 789, 1500, 4096 );
   speed_test( debug_output, 1e7, 32768, 789, 1500, 128 );
   speed_test( debug_output, 1e7, 32768, 789, 1500, 32 );
+
+  concurrent_speed_test( debug_output, 1e7, 32768, 789, 1500, 4096 );
+  concurrent_speed_test( debug_output, 1e7, 32768, 789, 1500, 128 );
 }
 } // namespace
 
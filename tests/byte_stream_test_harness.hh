@@ -4,6 +4,8 @@
 #include "common.hh"
 #include "helpers.hh"
 
+#include <algorithm>
+#include <span>
 #include <utility>
 
 static_assert( sizeof( Reader ) == sizeof( ByteStream ),
@@ -57,6 +59,87 @@ struct Pop : public Action<ByteStream>
   constexpr std::string obj() const override { return "Reader"; }
 };
 
+struct SetWatermarks : public Action<ByteStream>
+{
+  uint64_t low_, high_;
+
+  SetWatermarks( uint64_t low, uint64_t high ) : low_( low ), high_( high ) {}
+  std::string description() const override
+  {
+    return "set_watermarks( " + std::to_string( low_ ) + ", " + std::to_string( high_ ) + " )";
+  }
+  void execute( ByteStream& bs ) const override { bs.set_watermarks( low_, high_ ); }
+};
+
+struct SetRetainPopped : public Action<ByteStream>
+{
+  bool retain_;
+
+  explicit SetRetainPopped( bool retain ) : retain_( retain ) {}
+  std::string description() const override { return "set_retain_popped( " + to_string( retain_ ) + " )"; }
+  void execute( ByteStream& bs ) const override { bs.set_retain_popped( retain_ ); }
+};
+
+struct Release : public Action<ByteStream>
+{
+  size_t len_;
+
+  explicit Release( size_t len ) : len_( len ) {}
+  std::string description() const override { return "release( " + std::to_string( len_ ) + " )"; }
+  void execute( ByteStream& bs ) const override { bs.reader().release( len_ ); }
+  constexpr std::string obj() const override { return "Reader"; }
+};
+
+// reserve( len ), check the size of the space it returned, write `data` into it and commit what was written
+struct ReserveAndCommit : public Action<ByteStream>
+{
+  uint64_t len_;
+  std::string data_;
+  uint64_t reserved_;
+
+  ReserveAndCommit( uint64_t len, std::string data, uint64_t reserved )
+    : len_( len ), data_( move( data ) ), reserved_( reserved )
+  {}
+  std::string description() const override
+  {
+    return "reserve( " + std::to_string( len_ ) + " ) gives " + std::to_string( reserved_ ) + " bytes; commit \""
+           + pretty_print( data_ ) + "\"";
+  }
+  void execute( ByteStream& bs ) const override
+  {
+    const std::span<char> space = bs.writer().reserve( len_ );
+    if ( space.size() != reserved_ ) {
+      throw ExpectationViolation { "reserve() should have returned " + std::to_string( reserved_ )
+                                   + " bytes, but returned " + std::to_string( space.size() ) };
+    }
+    if ( data_.size() > space.size() ) {
+      throw std::runtime_error( "test error: more data than reserved space" );
+    }
+    std::ranges::copy( data_, space.begin() );
+    bs.writer().commit( data_.size() );
+  }
+  constexpr std::string obj() const override { return "Writer"; }
+};
+
+// commit( len ) without a reserve() that covers it must throw
+struct CommitRejected : public Action<ByteStream>
+{
+  uint64_t len_;
+
+  explicit CommitRejected( uint64_t len ) : len_( len ) {}
+  std::string description() const override { return "commit( " + std::to_string( len_ ) + " ) is rejected"; }
+  void execute( ByteStream& bs ) const override
+  {
+    try {
+      bs.writer().commit( len_ );
+    } catch ( const std::runtime_error& ) {
+      return;
+    }
+    throw ExpectationViolation { "commit() should have thrown" };
+  }
+  constexpr std::string obj() const override { return "Writer"; }
+};
+
 /* expectations */
 
 struct Peek : public Expectation<ByteStream>
@@ -119,6 +202,61 @@ struct PeekOnce : public Peek
   }
 };
 
+struct PeekIov : public Peek
+{
+  using Peek::Peek;
+
+  std::string description() const override
+  {
+    return "peek_iov() covers exactly \"" + pretty_print( output_ ) + "\"";
+  }
+
+  void execute( const ByteStream& bs ) const override
+  {
+    std::string got;
+    for ( const auto& segment : bs.reader().peek_iov() ) {
+      if ( segment.empty() ) {
+        throw ExpectationViolation { "peek_iov() returned an empty segment" };
+      }
+      got += segment;
+    }
+    if ( got != output_ ) {
+      throw ExpectationViolation { "peek_iov() should have covered \"" + pretty_print( output_ )
+                                   + "\", but instead covered \"" + pretty_print( got ) + "\"" };
+    }
+  }
+};
+
+struct PeekRetained : public Expectation<ByteStream>
+{
+  uint64_t offset_, len_;
+  std::string output_;
+
+  PeekRetained( uint64_t offset, uint64_t len, std::string output )
+    : offset_( offset ), len_( len ), output_( move( output ) )
+  {}
+
+  std::string description() const override
+  {
+    return "peek_retained( " + std::to_string( offset_ ) + ", " + std::to_string( len_ ) + " ) covers \""
+           + pretty_print( output_ ) + "\"";
+  }
+
+  void execute( const ByteStream& bs ) const override
+  {
+    std::string got;
+    for ( const auto& segment : bs.reader().peek_retained( offset_, len_ ) ) {
+      got += segment;
+    }
+    if ( got != output_ ) {
+      throw ExpectationViolation { "peek_retained() should have covered \"" + pretty_print( output_ )
+                                   + "\", but instead covered \"" + pretty_print( got ) + "\"" };
+    }
+  }
+
+  constexpr std::string obj() const override { return "Reader"; }
+};
+
 struct IsClosed : public ExpectBool<ByteStream>
 {
   using ExpectBool::ExpectBool;
@@ -135,6 +273,22 @@ struct IsFinished : public ExpectBool<ByteStream>
   constexpr std::string obj() const override { return "Reader"; }
 };
 
+struct IsReadable : public ExpectBool<ByteStream>
+{
+  using ExpectBool::ExpectBool;
+  std::string name() const override { return "readable"; }
+  bool value( const ByteStream& bs ) const override { return bs.reader().readable(); }
+  constexpr std::string obj() const override { return "Reader"; }
+};
+
+struct IsWritable : public ExpectBool<ByteStream>
+{
+  using ExpectBool::ExpectBool;
+  std::string name() const override { return "writable"; }
+  bool value( const ByteStream& bs ) const override { return bs.writer().writable(); }
+  constexpr std::string obj() const override { return "Writer"; }
+};
+
 struct HasError : public ExpectBool<ByteStream>
 {
   using ExpectBool::ExpectBool;
@@ -174,6 +328,14 @@ struct BytesPushed : public ExpectNumber<ByteStream, uint64_t>
   constexpr std::string obj() const override { return "Writer"; }
 };
 
+struct BytesRetained : public ExpectNumber<ByteStream, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "bytes_retained"; }
+  uint64_t value( const ByteStream& bs ) const override { return bs.reader().bytes_retained(); }
+  constexpr std::string obj() const override { return "Reader"; }
+};
+
 struct BytesPopped : public ExpectNumber<ByteStream, uint64_t>
 {
   using ExpectNumber::ExpectNumber;
@@ -0,0 +1,110 @@
+#include "byte_stream_test_harness.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main()
+{
+  try {
+    {
+      ByteStreamTestHarness test { "default watermarks", 4 };
+
+      test.execute( IsReadable { false } );
+      test.execute( IsWritable { true } );
+      test.execute( Push { "a" } );
+      test.execute( IsReadable { true } );
+      test.execute( Push { "bcd" } );
+      test.execute( IsWritable { false } );
+      test.execute( Pop { 1 } );
+      test.execute( IsWritable { true } );
+    }
+
+    {
+      ByteStreamTestHarness test { "low watermark holds back the writer", 8 };
+
+      test.execute( SetWatermarks { 2, 1 } );
+      test.execute( Push { "abcdefgh" } );
+      test.execute( IsWritable { false } );
+      test.execute( Pop { 3 } );
+      test.execute( AvailableCapacity { 3 } );
+      test.execute( IsWritable { false } );
+      test.execute( Pop { 3 } );
+      test.execute( IsWritable { true } );
+      test.execute( Push { "ij" } );
+      test.execute( IsWritable { false } );
+    }
+
+    {
+      ByteStreamTestHarness test { "high watermark holds back the reader", 8 };
+
+      test.execute( SetWatermarks { 8, 4 } );
+      test.execute( Push { "abc" } );
+      test.execute( IsReadable { false } );
+      test.execute( Push { "d" } );
+      test.execute( IsReadable { true } );
+      test.execute( Pop { 2 } );
+      test.execute( IsReadable { false } );
+      test.execute( Close {} );
+      test.execute( IsReadable { true } );
+    }
+
+    {
+      ByteStreamTestHarness test { "readiness flips at the crossings", 8 };
+
+      test.execute( SetWatermarks { 2, 4 } );
+      test.execute( IsReadable { false } );
+      test.execute( IsWritable { true } );
+      test.execute( Push { "abc" } );
+      test.execute( IsReadable { false } );
+      test.execute( IsWritable { false } );
+      test.execute( Push { "defgh" } );
+      test.execute( IsReadable { true } );
+      test.execute( Pop { 4 } );
+      test.execute( IsReadable { true } );
+      test.execute( IsWritable { false } );
+      test.execute( Pop { 1 } );
+      test.execute( IsReadable { false } );
+      test.execute( IsWritable { false } );
+      test.execute( Pop { 1 } );
+      test.execute( IsWritable { true } );
+      test.execute( Close {} );
+      test.execute( IsReadable { true } );
+    }
+
+    {
+      ByteStreamTestHarness test { "retained bytes hold back the writer until released", 8 };
+
+      test.execute( SetRetainPopped { true } );
+      test.execute( SetWatermarks { 2, 1 } );
+      test.execute( Push { "abcdefgh" } );
+      test.execute( Pop { 7 } );
+      test.execute( IsWritable { false } );
+      test.execute( Release { 7 } );
+      test.execute( IsWritable { true } );
+      test.execute( Push { "ijklmno" } );
+      test.execute( Pop { 6 } );
+      test.execute( IsWritable { false } );
+      test.execute( Release { 1 } );
+      test.execute( IsWritable { true } );
+    }
+
+    {
+      ByteStreamTestHarness test { "error makes both sides ready", 2 };
+
+      test.execute( Push { "ab" } );
+      test.execute( SetWatermarks { 0, 4 } );
+      test.execute( IsReadable { false } );
+      test.execute( IsWritable { false } );
+      test.execute( SetError {} );
+      test.execute( IsReadable { true } );
+      test.execute( IsWritable { true } );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
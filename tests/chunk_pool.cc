@@ -0,0 +1,147 @@
+#include "chunk_pool.hh"
+#include "helpers.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_sender.hh"
+
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+
+namespace {
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( what );
+  }
+}
+
+// A released buffer is handed out again for any request its size class can serve.
+void reuse_test()
+{
+  ChunkPool& pool = ChunkPool::local();
+  string chunk = pool.acquire( 1000 );
+  expect( chunk.capacity() >= 1000, "acquire() returned too small a buffer" );
+  chunk.assign( 700, 'x' );
+  const char* const memory = chunk.data();
+  pool.release( move( chunk ) );
+
+  const ChunkPool::Stats before = pool.stats();
+  string again = pool.acquire( 600 );
+  expect( pool.stats().hits == before.hits + 1, "acquire() missed the released buffer" );
+  expect( again.data() == memory, "acquire() did not reuse the released buffer" );
+  expect( again.empty(), "a reused buffer was not cleared" );
+  pool.release( move( again ) );
+}
+
+// Wrapping, serializing and writing a segment the way the TUN adapter does hands every pooled chunk back,
+// and the serialized datagram refers to the message's payload instead of copying it.
+void serialize_test()
+{
+  ChunkPool& pool = ChunkPool::local();
+  TCPOverIPv4Adapter adapter;
+  TCPSenderMessage msg;
+  msg.payload = string( 500, 'p' );
+
+  const uint64_t outstanding = pool.stats().outstanding;
+  uint64_t misses = 0;
+  for ( int i = 0; i < 100; ++i ) {
+    InternetDatagram datagram = adapter.wrap_tcp_in_ip( { .sender = borrow( msg ), .receiver = {} } );
+    auto buffers = serialize_pooled( datagram );
+    bool payload_borrowed = false;
+    for ( const auto& buffer : buffers ) {
+      payload_borrowed |= buffer.is_borrowed() and buffer.get().data() == msg.payload.data();
+    }
+    expect( payload_borrowed, "the serialized datagram copied the payload" );
+    pool.release( move( buffers ) );
+    pool.release( move( datagram.payload ) );
+
+    expect( pool.stats().outstanding == outstanding, "serializing a segment leaked pooled chunks" );
+    if ( i == 0 ) {
+      misses = pool.stats().misses;
+    }
+  }
+  expect( pool.stats().misses == misses, "serializing the same segment again did not reuse its chunks" );
+
+  // Plain serialize() does not draw from the pool at all.
+  InternetDatagram datagram = adapter.wrap_tcp_in_ip( { .sender = borrow( msg ), .receiver = {} } );
+  const ChunkPool::Stats before = pool.stats();
+  const auto buffers = serialize( datagram );
+  expect( pool.stats().hits == before.hits and pool.stats().misses == before.misses,
+          "serialize() drew from the pool" );
+  pool.release( move( datagram.payload ) );
+}
+
+// TCPSender takes each payload from the pool and gives it back once the segment has been transmitted.
+void sender_test()
+{
+  ChunkPool& pool = ChunkPool::local();
+  TCPConfig config;
+  TCPSender sender { ByteStream { 100000 }, config };
+  const uint64_t outstanding = pool.stats().outstanding;
+
+  uint64_t segments = 0;
+  const auto transmit = [&]( const TCPSenderMessage& msg ) {
+    ++segments;
+    expect( msg.payload.empty() or pool.stats().outstanding == outstanding + 1,
+            "more than one payload chunk in use at a time" );
+  };
+  sender.push( transmit ); // SYN
+  sender.receive( { .ackno = sender.make_empty_message().seqno, .window_size = UINT16_MAX } );
+  sender.writer().push( string( 50000, 'd' ) );
+  sender.push( transmit );
+  sender.tick( sender.current_RTO_ms(), transmit );
+  expect( segments > 1, "the sender sent too few segments" );
+  expect( pool.stats().outstanding == outstanding, "the sender kept pooled payload chunks" );
+}
+
+// Every thread has a pool of its own: buffers released on one thread are not handed out on another, and
+// neither thread's activity shows up in the other's statistics.
+void per_thread_test()
+{
+  ChunkPool& pool = ChunkPool::local();
+  pool.release( pool.acquire( 4000 ) );
+  const ChunkPool::Stats before = pool.stats();
+  expect( before.cached_bytes > 0, "the pool cached nothing" );
+
+  const ChunkPool* other_pool = nullptr;
+  ChunkPool::Stats other_first {};
+  ChunkPool::Stats other_last {};
+  thread other( [&] {
+    ChunkPool& mine = ChunkPool::local();
+    other_pool = &mine;
+    string chunk = mine.acquire( 4000 );
+    other_first = mine.stats();
+    mine.release( move( chunk ) );
+    mine.release( mine.acquire( 4000 ) );
+    other_last = mine.stats();
+  } );
+  other.join();
+
+  expect( other_pool != &pool, "two threads share a pool" );
+  expect( other_first.hits == 0 and other_first.misses == 1,
+          "another thread's first acquire() was served from this thread's cache" );
+  expect( other_last.hits == 1 and other_last.releases == 2, "another thread's pool did not reuse its own buffer" );
+
+  const ChunkPool::Stats after = pool.stats();
+  expect( after.hits == before.hits and after.misses == before.misses and after.releases == before.releases
+            and after.cached_bytes == before.cached_bytes,
+          "another thread's activity changed this thread's pool" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    reuse_test();
+    serialize_test();
+    sender_test();
+    per_thread_test();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
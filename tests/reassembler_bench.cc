@@ -0,0 +1,260 @@
+#include "bench.hh"
+#include "reassembler.hh"
+
+#include <array>
+#include <chrono>
+#include <random>
+#include <sys/resource.h>
+
+using namespace std;
+using namespace std::chrono;
+
+// Replays loss and reordering patterns through a Reassembler and reports throughput, per-insert
+// latency percentiles, the peak of count_bytes_pending() and the process's peak RSS, as CSV or JSON
+// (see bench.hh). Inputs that are correct but pathological for CPU show up as a blown-up p99 or max.
+// `--quick` runs every workload once on a small input; ctest runs it that way under a timeout.
+
+namespace {
+
+using bench::Sample;
+
+constexpr uint64_t segment_size = 1000;
+
+enum class Workload : uint8_t
+{
+  InOrder,        // baseline: every segment once, in order
+  Reverse,        // each block of segments arrives back to front
+  RandomReorder,  // each block is shuffled
+  BurstLoss,      // bursts of consecutive segments are lost and retransmitted at the end of the block
+  TailLoss,       // the last segments of each block arrive only after the start of the next block
+  TinyOverlap,    // many tiny, overlapping retransmissions arrive ahead of each block
+  DuplicateFlood, // every segment arrives repeatedly, both before and after it can be assembled
+};
+
+constexpr array all_workloads { Workload::InOrder,   Workload::Reverse,     Workload::RandomReorder,
+                                Workload::BurstLoss, Workload::TailLoss,    Workload::TinyOverlap,
+                                Workload::DuplicateFlood };
+
+string_view to_string( Workload workload )
+{
+  switch ( workload ) {
+    case Workload::InOrder:
+      return "in_order";
+    case Workload::Reverse:
+      return "reverse";
+    case Workload::RandomReorder:
+      return "random_reorder";
+    case Workload::BurstLoss:
+      return "burst_loss";
+    case Workload::TailLoss:
+      return "tail_loss";
+    case Workload::TinyOverlap:
+      return "tiny_overlap";
+    case Workload::DuplicateFlood:
+      return "duplicate_flood";
+  }
+  return "?";
+}
+
+struct Insert
+{
+  uint64_t first_index;
+  uint64_t length;
+};
+
+// The sequence of inserts for a workload. Blocks are half the stream's capacity, so a block plus the
+// stragglers of the one before it always fit in the window when the reader keeps up.
+vector<Insert> make_trace( Workload workload, uint64_t total, uint64_t capacity )
+{
+  default_random_engine rd { 6163 };
+  const uint64_t block_size = max( capacity / 2 / segment_size, uint64_t { 1 } ) * segment_size;
+  vector<Insert> trace;
+  vector<Insert> stragglers;
+
+  for ( uint64_t block = 0; block < total; block += block_size ) {
+    vector<Insert> segments;
+    for ( uint64_t i = block; i < min( block + block_size, total ); i += segment_size ) {
+      segments.push_back( { i, min( segment_size, total - i ) } );
+    }
+
+    switch ( workload ) {
+      case Workload::InOrder:
+        trace.insert( trace.end(), segments.begin(), segments.end() );
+        break;
+
+      case Workload::Reverse:
+        trace.insert( trace.end(), segments.rbegin(), segments.rend() );
+        break;
+
+      case Workload::RandomReorder:
+        ranges::shuffle( segments, rd );
+        trace.insert( trace.end(), segments.begin(), segments.end() );
+        break;
+
+      case Workload::BurstLoss: {
+        vector<Insert> lost;
+        for ( size_t i = 0; i < segments.size(); i++ ) {
+          if ( rd() % 16 == 0 ) {
+            const size_t burst_end = min( i + 8, segments.size() );
+            lost.insert( lost.end(), segments.begin() + i, segments.begin() + burst_end );
+            i = burst_end - 1;
+          } else {
+            trace.push_back( segments[i] );
+          }
+        }
+        trace.insert( trace.end(), lost.begin(), lost.end() );
+        break;
+      }
+
+      case Workload::TailLoss: {
+        const size_t head = min<size_t>( 4, segments.size() );
+        trace.insert( trace.end(), segments.begin(), segments.begin() + head );
+        trace.insert( trace.end(), stragglers.begin(), stragglers.end() );
+        const size_t tail = segments.size() - head > 4 ? segments.size() - 4 : head;
+        trace.insert( trace.end(), segments.begin() + head, segments.begin() + tail );
+        stragglers.assign( segments.begin() + tail, segments.end() );
+        break;
+      }
+
+      case Workload::TinyOverlap:
+        for ( uint64_t i = block + min( block_size, total - block ); i > block + 16; i -= 5 ) {
+          trace.push_back( { i - 16, 16 } );
+        }
+        trace.insert( trace.end(), segments.begin(), segments.end() );
+        break;
+
+      case Workload::DuplicateFlood:
+        for ( auto it = segments.rbegin(); it != segments.rend(); ++it ) {
+          trace.insert( trace.end(), 4, *it );
+        }
+        for ( const auto& segment : segments ) {
+          trace.insert( trace.end(), 4, segment );
+        }
+        break;
+    }
+  }
+
+  trace.insert( trace.end(), stragglers.begin(), stragglers.end() );
+  return trace;
+}
+
+struct Result
+{
+  Sample sample;
+  vector<double> latencies_ns;
+  uint64_t peak_pending;
+};
+
+Result run( const vector<Insert>& trace, const string& data, uint64_t capacity )
+{
+  // Build the payloads up front so that only the inserts themselves are timed.
+  vector<string> payloads;
+  payloads.reserve( trace.size() );
+  for ( const auto& insert : trace ) {
+    payloads.emplace_back( data.substr( insert.first_index, insert.length ) );
+  }
+
+  Reassembler reassembler { ByteStream { capacity } };
+  Result result { {}, {}, 0 };
+  result.latencies_ns.reserve( trace.size() );
+  uint64_t popped = 0;
+
+  const uint64_t allocations_before = bench::allocations();
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < trace.size(); i++ ) {
+    const auto insert_start = steady_clock::now();
+    reassembler.insert( trace[i].first_index,
+                        std::move( payloads[i] ),
+                        trace[i].first_index + trace[i].length == data.size() );
+    const auto insert_stop = steady_clock::now();
+    result.latencies_ns.push_back( duration<double, nano>( insert_stop - insert_start ).count() );
+    result.peak_pending = max( result.peak_pending, reassembler.count_bytes_pending() );
+
+    Reader& reader = reassembler.reader();
+    while ( reader.bytes_buffered() ) {
+      const auto peeked = reader.peek();
+      if ( data.compare( popped, peeked.size(), peeked ) != 0 ) {
+        throw runtime_error( "Mismatch between data written and read" );
+      }
+      popped += peeked.size();
+      reader.pop( peeked.size() );
+    }
+  }
+  const auto stop_time = steady_clock::now();
+
+  if ( not reassembler.reader().is_finished() ) {
+    throw runtime_error( "Reassembler did not finish the stream" );
+  }
+
+  result.sample = { duration_cast<duration<double>>( stop_time - start_time ).count(),
+                    data.size(),
+                    trace.size(),
+                    bench::allocations() - allocations_before };
+  return result;
+}
+
+uint64_t peak_rss_kib()
+{
+  rusage usage {};
+  getrusage( RUSAGE_SELF, &usage );
+  return usage.ru_maxrss;
+}
+
+void program_body( const bench::Options& options )
+{
+  const string data = [&] {
+    default_random_engine rd { 1370 };
+    uniform_int_distribution<char> ud;
+    string ret( options.bytes, 0 );
+    ranges::generate( ret, [&] { return ud( rd ); } );
+    return ret;
+  }();
+
+  bench::Report report { "reassembler", options };
+  const vector<uint64_t> capacities
+    = options.quick ? vector<uint64_t> { 64000 } : vector<uint64_t> { 4000, 64000, 1 << 20 };
+
+  for ( const auto workload : all_workloads ) {
+    for ( const auto capacity : capacities ) {
+      const auto trace = make_trace( workload, data.size(), capacity );
+      vector<Sample> samples;
+      vector<double> latencies;
+      uint64_t peak_pending = 0;
+      for ( size_t i = 0; i < options.repeat; i++ ) {
+        auto result = run( trace, data, capacity );
+        samples.push_back( result.sample );
+        latencies.insert( latencies.end(), result.latencies_ns.begin(), result.latencies_ns.end() );
+        peak_pending = max( peak_pending, result.peak_pending );
+      }
+
+      report.add( { { "workload", string { to_string( workload ) } },
+                    { "capacity", std::to_string( capacity ) },
+                    { "inserts", std::to_string( trace.size() ) } },
+                  samples,
+                  { { "insert_ns_p50", bench::Report::fmt( bench::percentile( latencies, 50 ) ) },
+                    { "insert_ns_p99", bench::Report::fmt( bench::percentile( latencies, 99 ) ) },
+                    { "insert_ns_p999", bench::Report::fmt( bench::percentile( latencies, 99.9 ) ) },
+                    { "insert_ns_max", bench::Report::fmt( bench::percentile( latencies, 100 ) ) },
+                    { "peak_pending", std::to_string( peak_pending ) },
+                    { "peak_rss_kib", std::to_string( peak_rss_kib() ) } } );
+    }
+  }
+
+  report.print( cout );
+}
+} // namespace
+
+int main( int argc, char** argv )
+{
+  try {
+    if ( argc <= 0 ) {
+      abort();
+    }
+    program_body( bench::Options::parse( { argv, static_cast<size_t>( argc ) } ) );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
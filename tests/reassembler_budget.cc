@@ -0,0 +1,147 @@
+#include "byte_stream_test_harness.hh"
+#include "reassembler_test_harness.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main()
+{
+  try {
+    {
+      ReassemblerTestHarness test { "budget charges the ring, which is kept for the next gap", 100000 };
+
+      test.execute( SetMemoryBudget { make_shared<MemoryBudget>( 10000, 20000, 40000 ) } );
+      test.execute( Insert { "abcdefghij", 30 } );
+      test.execute( BytesPending( 10 ) );
+      test.execute( MemoryUsed( 576 ) ); // a 512-byte ring and its bitmap
+
+      test.execute( Insert { "klmnopqrst", 3000 } );
+      test.execute( MemoryUsed( 3456 ) ); // grown to 3072 bytes
+
+      // The stream's own ring is charged too, as soon as it is allocated.
+      test.execute( Insert { "0123456789", 0 } );
+      test.execute( Insert { "ABCDEFGHIJKLMNOPQRST", 10 } );
+      test.execute( BytesPending( 10 ) );
+      test.execute( MemoryUsed( 4096 + 3456 ) );
+      test.execute( ReadAll( "0123456789ABCDEFGHIJKLMNOPQRSTabcdefghij" ) );
+      test.execute( Insert { string( 2960, '.' ), 40 } );
+      test.execute( BytesPending( 0 ) );
+      test.execute( MemoryUsed( 4096 + 3456 ) ); // both rings, though the pending one is empty
+
+      // The next gap reuses the ring.
+      test.execute( Insert { "uv", 3020 } );
+      test.execute( BytesPending( 2 ) );
+      test.execute( MemoryUsed( 4096 + 3456 ) );
+      test.execute( Insert { string( 10, '.' ), 3010 } );
+      test.execute( ReadAll( string( 2960, '.' ) + "klmnopqrst" + string( 10, '.' ) + "uv" ) );
+      test.execute( MemoryUsed( 4096 + 3456 ) );
+
+      // After 256 inserts that leave nothing pending (counting the one that filled the gap), the ring is freed.
+      for ( uint64_t i = 0; i < 254; i++ ) {
+        test.execute( Insert { "w", 3022 + i } );
+      }
+      test.execute( MemoryUsed( 4096 + 3456 ) );
+      test.execute( Insert { "w", 3276 } );
+      test.execute( MemoryUsed( 4096 ) );
+    }
+
+    {
+      ReassemblerTestHarness test { "an empty ring is freed under memory pressure", 100000 };
+
+      test.execute( SetMemoryBudget { make_shared<MemoryBudget>( 1000, 4000, 40000 ) } );
+      test.execute( Insert { "abcdefghij", 3000 } );
+      test.execute( MemoryUsed( 3456 ) );
+      test.execute( Insert { string( 3000, '.' ), 0 } );
+      test.execute( BytesPending( 0 ) );
+      test.execute( MemoryUsed( 4096 ) ); // over the pressure threshold with both rings, so the empty one goes
+    }
+
+    {
+      ReassemblerTestHarness test { "budget prunes furthest first and shrinks the ring", 100000 };
+
+      test.execute( SetMemoryBudget { make_shared<MemoryBudget>( 10000, 20000, 60000 ) } );
+      test.execute( Insert { "abcdefghij", 30 } );
+      test.execute( MemoryUsed( 576 ) );
+      test.execute( UnderPressure { false } );
+
+      // Holding bytes 50000 bytes out takes a 50048-byte ring, over the pressure threshold: the far bytes go,
+      // and the ring shrinks until its footprint is back under the threshold.
+      test.execute( Insert { "ABCDEFGHIJ", 50000 } );
+      test.execute( UnderPressure { true } );
+      test.execute( PrunedBytes( 10 ) );
+      test.execute( BytesPending( 10 ) );
+      test.execute( MemoryUsed( 19944 ) );
+      test.execute( HeldIntervals { { { 30, 40 } } } );
+
+      // Still under pressure (above the low threshold), so growing the ring again is undone the same way.
+      test.execute( Insert { "zz", 30000 } );
+      test.execute( UnderPressure { true } );
+      test.execute( PrunedBytes( 12 ) );
+      test.execute( MemoryUsed( 19944 ) );
+
+      // Bytes that fit in the shrunken ring are kept.
+      test.execute( Insert { "klmnopqrst", 10000 } );
+      test.execute( BytesPending( 20 ) );
+      test.execute( MemoryUsed( 19944 ) );
+
+      test.execute( Insert { string( 30, '.' ), 0 } );
+      test.execute( ReadAll( string( 30, '.' ) + "abcdefghij" ) );
+      test.execute( MemoryUsed( 19944 ) );
+      test.execute( Insert { string( 9960, '-' ), 40 } );
+      test.execute( ReadAll( string( 9960, '-' ) + "klmnopqrst" ) );
+      test.execute( BytesPending( 0 ) );
+      test.execute( MemoryUsed( 0 ) );
+      test.execute( UnderPressure { false } );
+    }
+
+    {
+      ReassemblerTestHarness test { "budget refuses when exhausted", 2000 };
+
+      test.execute( SetMemoryBudget { make_shared<MemoryBudget>( 100, 1000, 1500 ) } );
+      test.execute( Insert { string( 1600, 'a' ), 0 } );
+      test.execute( MemoryExhausted { true } );
+
+      test.execute( Insert { "zz", 1650 } );
+      test.execute( BytesPending( 0 ) );
+      test.execute( RefusedBytes( 2 ) );
+
+      // Assembling in-order data is always allowed.
+      test.execute( Insert { "z", 1600 } );
+      test.execute( MemoryUsed( 2000 ) ); // the stream's ring, at its full capacity
+
+      test.execute( ReadAll( string( 1600, 'a' ) + "z" ) );
+      test.execute( MemoryExhausted { false } );
+      test.execute( UnderPressure { false } );
+      test.execute( MemoryUsed( 0 ) );
+      test.execute( Insert { "zz", 1650 } );
+      test.execute( BytesPending( 2 ) );
+      test.execute( MemoryUsed( 576 ) );
+    }
+
+    {
+      ReassemblerTestHarness test { "budget released on destruction", 100 };
+
+      auto budget = make_shared<MemoryBudget>( 100, 200, 300 );
+      {
+        Reassembler r { ByteStream { 100 } };
+        r.reader().set_memory_budget( budget );
+        r.insert( 5, "abc", false );
+        r.insert( 0, "a", false );
+        const uint64_t used = budget->used();
+        const Reassembler copy = r;
+        if ( used != 100 + 144 or budget->used() != 2 * used ) {
+          throw runtime_error( "copied Reassembler should charge the budget again" );
+        }
+      }
+      test.execute( SetMemoryBudget { budget } );
+      test.execute( MemoryUsed( 0 ) );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
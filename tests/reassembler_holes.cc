@@ -155,6 +155,34 @@ int main()
       test.execute( BytesPushed( 600 ) );
       test.execute( BytesPending( 0 ) );
     }
+
+    {
+      ReassemblerTestHarness test { "in-order segment longer than the pending ring", 10000 };
+
+      test.execute( Insert { string( 10, 'b' ), 300 } );
+      test.execute( BytesPending( 10 ) );
+
+      test.execute( Insert { string( 5000, 'a' ), 0 } );
+      test.execute( BytesPushed( 5000 ) );
+      test.execute( BytesPending( 0 ) );
+      test.execute( ReadAll( string( 5000, 'a' ) ) );
+    }
+
+    {
+      ReassemblerTestHarness test { "in-order segment while bytes are held beyond it", 10000 };
+
+      test.execute( Insert { "x", 100 } );
+      test.execute( Insert { "y", 3000 } );
+      test.execute( BytesPending( 2 ) );
+
+      test.execute( Insert { string( 1000, 'a' ), 0 } );
+      test.execute( BytesPushed( 1000 ) );
+      test.execute( BytesPending( 1 ) );
+      test.execute( Insert { string( 2000, 'c' ), 1000 } );
+      test.execute( BytesPushed( 3001 ) );
+      test.execute( BytesPending( 0 ) );
+      test.execute( ReadAll( string( 1000, 'a' ) + string( 2000, 'c' ) + "y" ) );
+    }
   } catch ( const exception& e ) {
     cerr << "Exception: " << e.what() << "\n";
     return EXIT_FAILURE;
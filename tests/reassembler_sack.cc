@@ -0,0 +1,95 @@
+#include "byte_stream_test_harness.hh"
+#include "reassembler_test_harness.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main()
+{
+  try {
+    {
+      ReassemblerTestHarness test { "sack nothing held", 65000 };
+
+      test.execute( HeldIntervals { {} } );
+      test.execute( Insert { "abc", 0 } );
+      test.execute( HeldIntervals { {} } );
+      test.execute( Insert { "e", 10 } );
+      test.execute( Insert { "f", 11 } );
+      test.execute( Insert { "c", 2 } );
+      test.execute( HeldIntervals { { { 10, 12 } } } );
+    }
+
+    {
+      ReassemblerTestHarness test { "sack most recent first", 65000 };
+
+      test.execute( Insert { "b", 1 } );
+      test.execute( Insert { "d", 3 } );
+      test.execute( Insert { "f", 5 } );
+      test.execute( HeldIntervals { { { 5, 6 }, { 3, 4 }, { 1, 2 } } } );
+      test.execute( HeldIntervals { { { 5, 6 }, { 3, 4 } }, 2 } );
+      test.execute( HeldIntervals { {}, 0 } );
+
+      test.execute( Insert { "c", 2 } );
+      test.execute( HeldIntervals { { { 1, 4 }, { 5, 6 } } } );
+      test.execute( BytesPending( 4 ) );
+    }
+
+    {
+      ReassemblerTestHarness test { "sack overlapping and touching", 65000 };
+
+      test.execute( Insert { "fgh", 5 } );
+      test.execute( Insert { "ij", 8 } );
+      test.execute( HeldIntervals { { { 5, 10 } } } );
+      test.execute( Insert { "efghijk", 4 } );
+      test.execute( HeldIntervals { { { 4, 11 } } } );
+      test.execute( Insert { "gh", 6 } );
+      test.execute( HeldIntervals { { { 4, 11 } } } );
+      test.execute( BytesPending( 7 ) );
+    }
+
+    {
+      ReassemblerTestHarness test { "sack trimmed by assembly", 65000 };
+
+      test.execute( Insert { "cdef", 2 } );
+      test.execute( Insert { "ij", 8 } );
+      test.execute( Insert { "abcd", 0 } );
+      test.execute( HeldIntervals { { { 8, 10 } } } );
+      test.execute( ReadAll( "abcdef" ) );
+      test.execute( Insert { "gh", 6 } );
+      test.execute( HeldIntervals { {} } );
+      test.execute( ReadAll( "ghij" ) );
+      test.execute( BytesPending( 0 ) );
+    }
+
+    {
+      ReassemblerTestHarness test { "sack oldest dropped", 65000 };
+
+      for ( uint64_t i = 1; i < 12; i += 2 ) {
+        test.execute( Insert { "x", i } );
+      }
+      test.execute( HeldIntervals { { { 11, 12 }, { 9, 10 }, { 7, 8 }, { 5, 6 } } } );
+      test.execute( BytesPending( 6 ) );
+
+      // Extending an older range brings it back to the front.
+      test.execute( Insert { "x", 4 } );
+      test.execute( HeldIntervals { { { 4, 6 }, { 11, 12 }, { 9, 10 }, { 7, 8 } } } );
+    }
+
+    {
+      ReassemblerTestHarness test { "sack clipped to window", 4 };
+
+      test.execute( Insert { "bcdefg", 1 } );
+      test.execute( HeldIntervals { { { 1, 4 } } } );
+      test.execute( Insert { "a", 0 } );
+      test.execute( HeldIntervals { {} } );
+      test.execute( ReadAll( "abcd" ) );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
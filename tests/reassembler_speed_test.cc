@@ -82,8 +82,10 @@ void speed_test( const size_t num_chunks,  // NOLINT(bugprone-easily-swappable-p
   fstream debug_output;
   debug_output.open( "/dev/tty" );
 
+  const auto& stats = reassembler.stats();
   cout << "Reassembler to ByteStream with capacity=" << capacity << " reached " << fixed << setprecision( 2 )
-       << gigabits_per_second << " Gbit/s.\n";
+       << gigabits_per_second << " Gbit/s (" << stats.in_order << " in-order, " << stats.out_of_order
+       << " out-of-order, " << stats.outside_window << " outside-window inserts).\n";
 
   debug_output << "        Reassembler throughput " << scenario << fixed << setprecision( 2 ) << setw( 5 )
                << gigabits_per_second << " Gbit/s\n";
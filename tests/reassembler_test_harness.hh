@@ -4,8 +4,10 @@
 #include "helpers.hh"
 #include "reassembler.hh"
 
+#include <memory>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 template<std::derived_from<TestStep<ByteStream>> T>
 struct ReassemblerTestStep : public TestStep<Reassembler>
@@ -47,6 +49,98 @@ struct BytesPending : public ExpectNumber<Reassembler, uint64_t>
   uint64_t value( const Reassembler& r ) const override { return r.count_bytes_pending(); }
 };
 
+struct SetMemoryBudget : public Action<Reassembler>
+{
+  std::shared_ptr<MemoryBudget> budget_;
+
+  explicit SetMemoryBudget( std::shared_ptr<MemoryBudget> budget ) : budget_( std::move( budget ) ) {}
+  std::string description() const override { return "attach memory budget to the output stream"; }
+  void execute( Reassembler& r ) const override { r.reader().set_memory_budget( budget_ ); }
+};
+
+struct MemoryUsed : public ExpectNumber<Reassembler, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "memory_budget()->used"; }
+  uint64_t value( const Reassembler& r ) const override { return r.writer().memory_budget()->used(); }
+};
+
+struct UnderPressure : public ExpectBool<Reassembler>
+{
+  using ExpectBool::ExpectBool;
+  std::string name() const override { return "memory_budget()->state != Normal"; }
+  bool value( const Reassembler& r ) const override
+  {
+    return r.writer().memory_budget()->state() != MemoryBudget::State::Normal;
+  }
+};
+
+struct MemoryExhausted : public ExpectBool<Reassembler>
+{
+  using ExpectBool::ExpectBool;
+  std::string name() const override { return "memory_budget()->state == Exhausted"; }
+  bool value( const Reassembler& r ) const override
+  {
+    return r.writer().memory_budget()->state() == MemoryBudget::State::Exhausted;
+  }
+};
+
+struct PrunedBytes : public ExpectNumber<Reassembler, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "stats().pruned_bytes"; }
+  uint64_t value( const Reassembler& r ) const override { return r.stats().pruned_bytes; }
+};
+
+struct RefusedBytes : public ExpectNumber<Reassembler, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "memory_budget()->stats().bytes_refused"; }
+  uint64_t value( const Reassembler& r ) const override
+  {
+    return r.writer().memory_budget()->stats().bytes_refused;
+  }
+};
+
+// held_intervals( max_count ), most recent first, as {first_index, end} pairs
+struct HeldIntervals : public Expectation<Reassembler>
+{
+  std::vector<std::pair<uint64_t, uint64_t>> intervals_;
+  size_t max_count_;
+
+  explicit HeldIntervals( std::vector<std::pair<uint64_t, uint64_t>> intervals,
+                          size_t max_count = Reassembler::MAX_HELD_INTERVALS )
+    : intervals_( std::move( intervals ) ), max_count_( max_count )
+  {}
+
+  static std::string str( const std::vector<std::pair<uint64_t, uint64_t>>& intervals )
+  {
+    std::ostringstream ss;
+    ss << "{";
+    for ( const auto& [first_index, end] : intervals ) {
+      ss << " [" << first_index << ", " << end << ")";
+    }
+    ss << " }";
+    return ss.str();
+  }
+
+  std::string description() const override
+  {
+    return "held_intervals(" + std::to_string( max_count_ ) + ") = " + str( intervals_ );
+  }
+
+  void execute( const Reassembler& r ) const override
+  {
+    std::vector<std::pair<uint64_t, uint64_t>> actual;
+    for ( const auto& interval : r.held_intervals( max_count_ ) ) {
+      actual.emplace_back( interval.first_index, interval.end );
+    }
+    if ( actual != intervals_ ) {
+      throw ExpectationViolation { "should have had " + description() + ", but instead it was " + str( actual ) };
+    }
+  }
+};
+
 struct Insert : public Action<Reassembler>
 {
   std::string data_;
@@ -1,12 +1,14 @@
 #pragma once
 
 #include "common.hh"
+#include "tcp_config.hh"
 #include "tcp_receiver.hh"
 #include "tcp_receiver_message.hh"
 
 #include <optional>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 template<std::derived_from<TestStep<Reassembler>> T>
 struct DirectReassemblerTest : public TestStep<TCPReceiver>
@@ -43,6 +45,12 @@ public:
                    { TCPReceiver { Reassembler { ByteStream { capacity } } } } )
   {}
 
+  TCPReceiverTestHarness( std::string test_name, const TCPConfig& config )
+    : TestHarness( move( test_name ),
+                   "capacity=" + std::to_string( config.recv_capacity ) + " and sack=" + to_string( config.sack ),
+                   { TCPReceiver { Reassembler { ByteStream { config.recv_capacity } }, config } } )
+  {}
+
   template<std::derived_from<TestStep<Reassembler>> T>
   void execute( const T& test )
   {
@@ -58,11 +66,11 @@ public:
   using TestHarness<TCPReceiver>::execute;
 };
 
-struct ExpectWindow : public ExpectNumber<TCPReceiver, uint16_t>
+struct ExpectWindow : public ExpectNumber<TCPReceiver, uint32_t>
 {
   using ExpectNumber::ExpectNumber;
   std::string name() const override { return "window_size"; }
-  uint16_t value( const TCPReceiver& rs ) const override { return rs.send().window_size; }
+  uint32_t value( const TCPReceiver& rs ) const override { return rs.send().window_size; }
 };
 
 struct ExpectAckno : public ExpectNumber<TCPReceiver, std::optional<Wrap32>>
@@ -80,6 +88,40 @@ struct ExpectReset : public ExpectBool<TCPReceiver>
   bool value( const TCPReceiver& rs ) const override { return rs.send().RST; }
 };
 
+// The SACK blocks the receiver would send, as (begin, end) sequence numbers, first block first
+struct ExpectSACKBlocks : public Expectation<TCPReceiver>
+{
+  std::vector<std::pair<Wrap32, Wrap32>> blocks_;
+
+  explicit ExpectSACKBlocks( std::vector<std::pair<Wrap32, Wrap32>> blocks ) : blocks_( std::move( blocks ) ) {}
+
+  static std::string describe( const std::vector<std::pair<Wrap32, Wrap32>>& blocks )
+  {
+    std::ostringstream ss;
+    ss << "[";
+    for ( const auto& [begin, end] : blocks ) {
+      ss << " " << to_string( begin ) << "-" << to_string( end );
+    }
+    ss << " ]";
+    return ss.str();
+  }
+
+  std::string description() const override { return "SACK blocks " + describe( blocks_ ); }
+
+  void execute( const TCPReceiver& rs ) const override
+  {
+    const TCPReceiverMessage msg = rs.send();
+    std::vector<std::pair<Wrap32, Wrap32>> actual;
+    for ( const auto& block : msg.sack_blocks() ) {
+      actual.emplace_back( block.begin, block.end );
+    }
+    if ( actual != blocks_ ) {
+      throw ExpectationViolation( "TCPReceiver should have sent SACK blocks " + describe( blocks_ )
+                                  + ", but instead it sent " + describe( actual ) );
+    }
+  }
+};
+
 struct ExpectAcknoBetween : public Expectation<TCPReceiver>
 {
   Wrap32 isn_;
@@ -132,6 +174,12 @@ struct SegmentArrives : public Action<TCPReceiver>
     return *this;
   }
 
+  SegmentArrives& with_sack_permitted()
+  {
+    msg_.SACK_permitted = true;
+    return *this;
+  }
+
   SegmentArrives& with_rst()
   {
     msg_.RST = true;
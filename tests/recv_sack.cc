@@ -0,0 +1,119 @@
+#include "byte_stream_test_harness.hh"
+#include "checksum.hh"
+#include "helpers.hh"
+#include "random.hh"
+#include "reassembler_test_harness.hh"
+#include "receiver_test_harness.hh"
+#include "tcp_segment.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      cfg.sack = true;
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "SACK blocks report held data, latest first", cfg };
+      test.execute( SegmentArrives {}.with_syn().with_sack_permitted().with_seqno( isn ) );
+      test.execute( ExpectSACKBlocks { {} } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "efgh" ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 1 } } );
+      test.execute( ExpectSACKBlocks { { { Wrap32 { isn + 5 }, Wrap32 { isn + 9 } } } } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 13 ).with_data( "mnop" ) );
+      test.execute( ExpectSACKBlocks {
+        { { Wrap32 { isn + 13 }, Wrap32 { isn + 17 } }, { Wrap32 { isn + 5 }, Wrap32 { isn + 9 } } } } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 9 ).with_data( "ijkl" ) );
+      test.execute( ExpectSACKBlocks { { { Wrap32 { isn + 5 }, Wrap32 { isn + 17 } } } } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 17 } } );
+      test.execute( ExpectSACKBlocks { {} } );
+      test.execute( ReadAll { "abcdefghijklmnop" } );
+    }
+
+    {
+      TCPConfig cfg;
+      cfg.sack = true;
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "No SACK blocks unless the peer permitted them", cfg };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "efgh" ) );
+      test.execute( BytesPending { 4 } );
+      test.execute( ExpectSACKBlocks { {} } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "No SACK blocks unless configured", TCPConfig {} };
+      test.execute( SegmentArrives {}.with_syn().with_sack_permitted().with_seqno( isn ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "efgh" ) );
+      test.execute( BytesPending { 4 } );
+      test.execute( ExpectSACKBlocks { {} } );
+    }
+
+    {
+      // SACK-permitted and SACK options survive serialization and parsing.
+      TCPSenderMessage sent { .seqno = Wrap32 { 1000 }, .SYN = true, .payload = "hello", .SACK_permitted = true };
+      TCPReceiverMessage acked { .ackno = Wrap32 { 77 }, .window_size = 500 };
+      acked.add_sack_block( { Wrap32 { 80 }, Wrap32 { 90 } } );
+      acked.add_sack_block( { Wrap32 { 100 }, Wrap32 { 120 } } );
+      acked.add_sack_block( { Wrap32 { 130 }, Wrap32 { 131 } } );
+
+      TCPSegment segment { .message = { .sender = std::move( sent ), .receiver = std::move( acked ) } };
+      segment.compute_checksum( 0 );
+      const string wire = concat( serialize( segment ) );
+      if ( segment.header_length() != 20 + 4 + 28 or wire.size() != segment.header_length() + 5U ) {
+        throw runtime_error( "unexpected header length " + to_string( segment.header_length() ) );
+      }
+
+      TCPSegment parsed;
+      if ( not parse( parsed, vector<string> { wire }, 0 ) ) {
+        throw runtime_error( "could not parse a segment with options" );
+      }
+      if ( not parsed.message.sender->SACK_permitted or parsed.message.sender->payload != "hello"
+           or parsed.message.receiver->sack_blocks().size() != 3
+           or parsed.message.receiver->sack_blocks()[1].begin != Wrap32 { 100 }
+           or parsed.message.receiver->sack_blocks()[1].end != Wrap32 { 120 } ) {
+        throw runtime_error( "options did not round-trip: " + parsed.to_string() );
+      }
+    }
+
+    {
+      // An option kind in the last byte of the options has no length byte; the payload must not supply one.
+      TCPSenderMessage sent { .seqno = Wrap32 { 1000 }, .SYN = true, .payload = "hello", .SACK_permitted = true };
+      TCPSegment segment { .message = { .sender = std::move( sent ), .receiver = TCPReceiverMessage {} } };
+      string wire = concat( serialize( segment ) );
+      if ( wire.size() != 20 + 4 + 5U ) {
+        throw runtime_error( "unexpected segment length " + to_string( wire.size() ) );
+      }
+      wire.replace( 20, 4, "\x01\x01\x01\x05" ); // NOP, NOP, NOP, then SACK with no room for its length
+
+      InternetChecksum check;
+      check.add( wire );
+      const uint16_t cksum = check.value();
+      wire[16] = static_cast<char>( cksum >> 8 );
+      wire[17] = static_cast<char>( cksum );
+
+      TCPSegment parsed;
+      if ( not parse( parsed, vector<string> { wire }, 0 ) ) {
+        throw runtime_error( "could not parse a segment with a truncated option" );
+      }
+      if ( parsed.message.sender->payload != "hello" or not parsed.message.receiver->sack_blocks().empty() ) {
+        throw runtime_error( "truncated option consumed the payload: " + parsed.to_string() );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
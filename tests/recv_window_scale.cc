@@ -0,0 +1,188 @@
+#include "helpers.hh"
+#include "random.hh"
+#include "receiver_test_harness.hh"
+#include "tcp_peer.hh"
+#include "tcp_segment.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Two TCPPeers whose messages cross a wire (serialized and parsed) in both directions.
+struct Link
+{
+  TCPPeer client;
+  TCPPeer server;
+  vector<TCPMessage> to_client {};
+  vector<TCPMessage> to_server {};
+  uint16_t last_window_field_to_server {}; // as it was in the header
+  optional<uint8_t> window_scale_to_client {}; // in the last SYN sent to the client
+
+  Link( const TCPConfig& client_config, const TCPConfig& server_config )
+    : client( client_config ), server( server_config )
+  {}
+
+  auto transmit_to( vector<TCPMessage>& queue, bool to_server_side )
+  {
+    return [this, &queue, to_server_side]( TCPMessage msg ) {
+      TCPSegment segment { .message = std::move( msg ) };
+      segment.compute_checksum( 0 );
+      TCPSegment parsed;
+      if ( not parse( parsed, vector<string> { concat( serialize( segment ) ) }, 0 ) ) {
+        throw runtime_error( "could not parse " + segment.to_string() );
+      }
+      if ( to_server_side ) {
+        last_window_field_to_server = static_cast<uint16_t>( parsed.message.receiver->window_size );
+      } else if ( parsed.message.sender->SYN ) {
+        window_scale_to_client = parsed.message.sender->window_scale;
+      }
+      queue.push_back( std::move( parsed.message ) );
+    };
+  }
+
+  // Deliver everything in flight, and whatever that sends in turn.
+  void run()
+  {
+    while ( not to_client.empty() or not to_server.empty() ) {
+      for ( auto& msg : exchange( to_server, {} ) ) {
+        server.receive( std::move( msg ), transmit_to( to_client, false ) );
+      }
+      for ( auto& msg : exchange( to_client, {} ) ) {
+        client.receive( std::move( msg ), transmit_to( to_server, true ) );
+      }
+    }
+  }
+
+  void connect()
+  {
+    client.push( transmit_to( to_server, true ) );
+    run();
+  }
+};
+
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      cfg.recv_capacity = 200000;
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "Without window scaling, the window stops at 65,535 bytes", cfg };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( ExpectWindow { UINT16_MAX } );
+    }
+
+    {
+      TCPConfig cfg;
+      cfg.recv_capacity = 200000;
+      cfg.window_scaling = true;
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "With window scaling, the whole capacity is advertised", cfg };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( ExpectWindow { 200000 } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( string( 1000, 'x' ) ) );
+      test.execute( ExpectWindow { 199000 } );
+    }
+
+    {
+      TCPConfig cfg;
+      if ( cfg.window_shift() != 0 ) {
+        throw runtime_error( "the default capacity should need no shift" );
+      }
+      cfg.recv_capacity = 1 << 20;
+      if ( cfg.window_shift() != 5 ) {
+        throw runtime_error( "1 MiB should need a shift of 5, not " + to_string( cfg.window_shift() ) );
+      }
+      cfg.recv_capacity = uint64_t { 1 } << 40;
+      if ( cfg.window_shift() != TCPConfig::MAX_WINDOW_SHIFT ) {
+        throw runtime_error( "the shift should stop at 14" );
+      }
+    }
+
+    {
+      // The window scale option survives serialization and parsing; the window field is 16 bits.
+      TCPSenderMessage sent { .seqno = Wrap32 { 1000 }, .SYN = true, .window_scale = 7 };
+      TCPSegment segment { .message = { .sender = std::move( sent ),
+                                        .receiver = TCPReceiverMessage { .window_size = 100000 } } };
+      segment.compute_checksum( 0 );
+      const string wire = concat( serialize( segment ) );
+      if ( segment.header_length() != 20 + 4 or wire.size() != segment.header_length() ) {
+        throw runtime_error( "unexpected header length " + to_string( segment.header_length() ) );
+      }
+
+      TCPSegment parsed;
+      if ( not parse( parsed, vector<string> { wire }, 0 ) ) {
+        throw runtime_error( "could not parse a segment with a window scale option" );
+      }
+      if ( parsed.message.sender->window_scale != 7 or parsed.message.receiver->window_size != UINT16_MAX ) {
+        throw runtime_error( "window scale did not round-trip: " + parsed.to_string() );
+      }
+    }
+
+    {
+      // Peers that both offer window scaling can fill a window beyond 64 KB.
+      TCPConfig cfg;
+      cfg.recv_capacity = 1 << 20;
+      cfg.send_capacity = 1 << 20;
+      cfg.window_scaling = true;
+      Link link { cfg, cfg };
+      link.connect();
+      if ( link.window_scale_to_client != 5 ) {
+        throw runtime_error( "the SYN-ACK should offer a window scale of 5" );
+      }
+      if ( link.last_window_field_to_server != ( 1 << 20 ) >> 5 ) {
+        throw runtime_error( "the window field should be scaled, not "
+                             + to_string( link.last_window_field_to_server ) );
+      }
+
+      link.server.outbound_writer().push( string( 300000, 'x' ) );
+      link.server.push( link.transmit_to( link.to_client, false ) );
+      if ( link.server.sender().sequence_numbers_in_flight() != 300000 ) {
+        throw runtime_error( "expected the whole write in flight, not "
+                             + to_string( link.server.sender().sequence_numbers_in_flight() ) );
+      }
+      link.run();
+      if ( link.client.inbound_reader().bytes_buffered() != 300000
+           or link.server.sender().sequence_numbers_in_flight() ) {
+        throw runtime_error( "the write was not delivered and acknowledged" );
+      }
+    }
+
+    {
+      // Window scaling needs both SYNs to offer it.
+      TCPConfig client_cfg;
+      client_cfg.recv_capacity = 1 << 20;
+      TCPConfig server_cfg = client_cfg;
+      server_cfg.send_capacity = 1 << 20;
+      server_cfg.window_scaling = true;
+      Link link { client_cfg, server_cfg };
+      link.connect();
+      if ( link.window_scale_to_client.has_value() ) {
+        throw runtime_error( "the SYN-ACK answered a SYN without window scaling, so it must not offer it" );
+      }
+
+      link.server.outbound_writer().push( string( 300000, 'x' ) );
+      link.server.push( link.transmit_to( link.to_client, false ) );
+      if ( link.server.sender().sequence_numbers_in_flight() != UINT16_MAX ) {
+        throw runtime_error( "expected 65,535 bytes in flight, not "
+                             + to_string( link.server.sender().sequence_numbers_in_flight() ) );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,120 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.congestion_control = TCPConfig::CongestionAlgorithm::NewReno;
+
+      TCPSenderTestHarness test { "NewReno starts with ten segments and grows in slow start", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( Receive { { isn + 1, UINT16_MAX } }.without_push() );
+      test.execute( ExpectCongestionWindow { 10000 } );
+      test.execute( Push { string( 20000, 'x' ) } );
+      for ( unsigned i = 0; i < 10; i++ ) {
+        test.execute( ExpectMessage {}.with_no_flags().with_payload_size( 1000 ).with_seqno( isn + 1 + i * 1000 ) );
+      }
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 10000 } );
+
+      // Each acknowledged byte lets one more byte out, and one more into the window.
+      test.execute( Receive { { isn + 2001, UINT16_MAX } } );
+      test.execute( ExpectCongestionWindow { 12000 } );
+      for ( unsigned i = 10; i < 14; i++ ) {
+        test.execute( ExpectMessage {}.with_no_flags().with_payload_size( 1000 ).with_seqno( isn + 1 + i * 1000 ) );
+      }
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 12000 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      const uint16_t retx_timeout = uniform_int_distribution<uint16_t> { 10, 10000 }( rd );
+      cfg.isn = isn;
+      cfg.rt_timeout = retx_timeout;
+      cfg.congestion_control = TCPConfig::CongestionAlgorithm::NewReno;
+
+      TCPSenderTestHarness test { "NewReno collapses to one segment on timeout", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( Receive { { isn + 1, UINT16_MAX } }.without_push() );
+      test.execute( Push { string( 10000, 'x' ) } );
+      for ( unsigned i = 0; i < 10; i++ ) {
+        test.execute( ExpectMessage {}.with_payload_size( 1000 ) );
+      }
+      test.execute( Tick { retx_timeout } );
+      test.execute( ExpectMessage {}.with_no_flags().with_payload_size( 1000 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectCongestionWindow { 1000 } );
+      test.execute( ExpectSlowStartThreshold { 5000 } );
+
+      // Backing off again doesn't shrink the window further.
+      test.execute( Tick { 2UL * retx_timeout } );
+      test.execute( ExpectMessage {}.with_seqno( isn + 1 ) );
+      test.execute( ExpectSlowStartThreshold { 5000 } );
+
+      test.execute( Receive { { isn + 1001, UINT16_MAX } } );
+      test.execute( ExpectCongestionWindow { 2000 } );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      const uint16_t retx_timeout = uniform_int_distribution<uint16_t> { 10, 10000 }( rd );
+      cfg.isn = isn;
+      cfg.rt_timeout = retx_timeout;
+      cfg.congestion_control = TCPConfig::CongestionAlgorithm::Cubic;
+
+      TCPSenderTestHarness test { "CUBIC reduces the threshold by beta", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( Receive { { isn + 1, UINT16_MAX } }.without_push() );
+      test.execute( Push { string( 10000, 'x' ) } );
+      for ( unsigned i = 0; i < 10; i++ ) {
+        test.execute( ExpectMessage {}.with_payload_size( 1000 ) );
+      }
+      test.execute( Tick { retx_timeout } );
+      test.execute( ExpectMessage {}.with_seqno( isn + 1 ) );
+      test.execute( ExpectCongestionWindow { 1000 } );
+      test.execute( ExpectSlowStartThreshold { 7000 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.congestion_control = TCPConfig::CongestionAlgorithm::Cubic;
+
+      TCPSenderTestHarness test { "Congestion window never exceeds the receiver's window", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( Receive { { isn + 1, 3000 } }.without_push() );
+      test.execute( Push { string( 10000, 'x' ) } );
+      for ( unsigned i = 0; i < 3; i++ ) {
+        test.execute( ExpectMessage {}.with_payload_size( 1000 ) );
+      }
+      test.execute( ExpectNoSegment {} );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
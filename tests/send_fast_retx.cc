@@ -0,0 +1,193 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.fast_retransmit = true;
+
+      TCPSenderTestHarness test { "Third duplicate ack retransmits the first outstanding segment", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( Receive { { isn + 1, 4000 } } );
+      test.execute( Push { "abcd" } );
+      test.execute( ExpectMessage {}.with_data( "abcd" ) );
+      test.execute( Push { "efgh" } );
+      test.execute( ExpectMessage {}.with_data( "efgh" ) );
+      test.execute( Push { "ijkl" } );
+      test.execute( ExpectMessage {}.with_data( "ijkl" ) );
+      test.execute( Push { "mnop" } );
+      test.execute( ExpectMessage {}.with_data( "mnop" ) );
+
+      test.execute( Receive { { isn + 5, 4000 } } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Receive { { isn + 5, 4000 } } );
+      test.execute( Receive { { isn + 5, 4000 } } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Receive { { isn + 5, 4000 } } );
+      test.execute( ExpectMessage {}.with_no_flags().with_data( "efgh" ).with_seqno( isn + 5 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Receive { { isn + 5, 4000 } } );
+      test.execute( ExpectNoSegment {} );
+
+      // A partial ack means the next segment was lost as well.
+      test.execute( Receive { { isn + 9, 4000 } } );
+      test.execute( ExpectMessage {}.with_data( "ijkl" ).with_seqno( isn + 9 ) );
+      test.execute( ExpectConsecutiveRetransmissions { 0 } );
+      test.execute( Receive { { isn + 17, 4000 } } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 0 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.fast_retransmit = true;
+
+      TCPSenderTestHarness test { "Window updates are not duplicate acks", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( Receive { { isn + 1, 4000 } } );
+      test.execute( Push { "abcdefgh" } );
+      test.execute( ExpectMessage {}.with_data( "abcdefgh" ) );
+      test.execute( Receive { { isn + 1, 4001 } } );
+      test.execute( Receive { { isn + 1, 4002 } } );
+      test.execute( Receive { { isn + 1, 4003 } } );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "Duplicate acks are ignored unless fast retransmit is on", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( Receive { { isn + 1, 4000 } } );
+      test.execute( Push { "abcd" } );
+      test.execute( Push { "efgh" } );
+      test.execute( ExpectMessage {}.with_data( "abcd" ) );
+      test.execute( ExpectMessage {}.with_data( "efgh" ) );
+      for ( int i = 0; i < 4; i++ ) {
+        test.execute( Receive { { isn + 1, 4000 } } );
+      }
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.fast_retransmit = true;
+      cfg.congestion_control = TCPConfig::CongestionAlgorithm::NewReno;
+
+      TCPSenderTestHarness test { "Limited transmit and NewReno fast recovery", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( Receive { { isn + 1, UINT16_MAX } }.without_push() );
+      test.execute( Push { string( 15000, 'x' ) } );
+      for ( unsigned i = 0; i < 10; i++ ) {
+        test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 + i * 1000 ) );
+      }
+      test.execute( ExpectNoSegment {} );
+
+      // The first two duplicate acks each let one new segment out.
+      test.execute( Receive { { isn + 1, UINT16_MAX } } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 10001 ) );
+      test.execute( Receive { { isn + 1, UINT16_MAX } } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 11001 ) );
+      test.execute( ExpectNoSegment {} );
+
+      // The third retransmits the first segment and halves the window: ssthresh = 12000 / 2.
+      test.execute( Receive { { isn + 1, UINT16_MAX } } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectCongestionWindow { 6000 } );
+      test.execute( ExpectSlowStartThreshold { 6000 } );
+
+      // Window = 6000 + 1000 per duplicate ack, so new data flows again once 12000 fits.
+      for ( unsigned i = 4; i < 7; i++ ) {
+        test.execute( Receive { { isn + 1, UINT16_MAX } } );
+        test.execute( ExpectNoSegment {} );
+      }
+      test.execute( Receive { { isn + 1, UINT16_MAX } } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 12001 ) );
+      test.execute( ExpectNoSegment {} );
+
+      // Partial ack: retransmit the next hole; 8000 in flight against a window of 6000 + 3000.
+      test.execute( Receive { { isn + 5001, UINT16_MAX } } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 5001 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 13001 ) );
+      test.execute( ExpectNoSegment {} );
+
+      // Full ack: leave recovery with the window at ssthresh.
+      test.execute( Receive { { isn + 14001, UINT16_MAX } } );
+      test.execute( ExpectCongestionWindow { 6000 } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 14001 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.fast_retransmit = true;
+      cfg.congestion_control = TCPConfig::CongestionAlgorithm::NewReno;
+
+      TCPSenderTestHarness test { "Duplicate acks for data sent before a timeout don't start fast recovery", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( Receive { { isn + 1, UINT16_MAX } }.without_push() );
+      test.execute( Push { string( 4000, 'x' ) } );
+      for ( unsigned i = 0; i < 4; i++ ) {
+        test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 + i * 1000 ) );
+      }
+
+      // The timeout resends the first segment and collapses the window: ssthresh = 4000 / 2.
+      test.execute( Tick { cfg.rt_timeout } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectCongestionWindow { 1000 } );
+      test.execute( ExpectSlowStartThreshold { 2000 } );
+
+      // The segments sent before the timeout still draw duplicate acks, which mustn't cut the window again.
+      for ( unsigned i = 0; i < 3; i++ ) {
+        test.execute( Receive { { isn + 1, UINT16_MAX } } );
+      }
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectCongestionWindow { 1000 } );
+      test.execute( ExpectSlowStartThreshold { 2000 } );
+
+      // Once everything sent before the timeout is acknowledged, duplicate acks count again.
+      test.execute( Receive { { isn + 4001, UINT16_MAX } } );
+      test.execute( Push { string( 3000, 'y' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 4001 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 5001 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 6001 ) );
+      for ( unsigned i = 0; i < 3; i++ ) {
+        test.execute( Receive { { isn + 4001, UINT16_MAX } } );
+      }
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 4001 ) );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
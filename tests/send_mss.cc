@@ -0,0 +1,208 @@
+#include "helpers.hh"
+#include "random.hh"
+#include "sender_test_harness.hh"
+#include "tcp_segment.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "The SYN advertises the default MSS", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_mss( TCPConfig::MAX_PAYLOAD_SIZE ) );
+      test.execute( ExpectMSS { TCPConfig::MAX_PAYLOAD_SIZE } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.mss = 1460;
+
+      TCPSenderTestHarness test { "Segments are as big as the configured MSS", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_mss( 1460 ) );
+      test.execute( Receive { { isn + 1, 10000 } } );
+      test.execute( Push { string( 3000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 1460 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1460 ).with_seqno( isn + 1461 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 80 ).with_seqno( isn + 2921 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.mss = 1460;
+
+      TCPSenderTestHarness test { "The peer's MSS option lowers the MSS", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( PeerMSS { 536 } );
+      test.execute( ExpectMSS { 536 } );
+      test.execute( Receive { { isn + 1, 10000 } } );
+      test.execute( Push { string( 1200, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 536 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 536 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 128 ) );
+      test.execute( PeerMSS { 9000 } );
+      test.execute( ExpectMSS { 536 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.mss = 1460;
+      cfg.mtu_probing = true;
+
+      TCPSenderTestHarness test { "Acknowledged probes raise the MSS", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_mss( 1460 ) );
+      test.execute( ExpectMSS { 1000 } );
+      test.execute( Receive { { isn + 1, 20000 } } );
+      test.execute( Push { string( 5000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 1230 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1231 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 770 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Receive { { isn + 1231, 20000 } } );
+      test.execute( ExpectMSS { 1230 } );
+      test.execute( Push { string( 2000, 'y' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 1345 ).with_seqno( isn + 5001 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 655 ) );
+      test.execute( Receive { { isn + 7001, 20000 } } );
+      test.execute( ExpectMSS { 1345 } );
+      test.execute( ExpectSeqnosInFlight { 0 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.mss = 1460;
+      cfg.mtu_probing = true;
+
+      TCPSenderTestHarness test { "A probe that times out is resent in smaller segments, without backoff", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( Receive { { isn + 1, 20000 } } );
+      test.execute( Push { string( 1500, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 1230 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 270 ).with_seqno( isn + 1231 ) );
+      test.execute( Tick { cfg.rt_timeout } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 230 ).with_seqno( isn + 1001 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectRTO { cfg.rt_timeout } );
+      test.execute( ExpectConsecutiveRetransmissions { 0 } );
+      test.execute( Receive { { isn + 1501, 20000 } } );
+      test.execute( ExpectMSS { 1000 } );
+      test.execute( ExpectSeqnosInFlight { 0 } );
+      // The search goes on below the size that failed.
+      test.execute( Push { string( 1200, 'y' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 1115 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 85 ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.mss = 1460;
+      cfg.mtu_probing = true;
+      cfg.fast_retransmit = true;
+      cfg.congestion_control = TCPConfig::CongestionAlgorithm::NewReno;
+
+      TCPSenderTestHarness test { "Duplicate acks for a lost probe don't start fast recovery", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( Receive { { isn + 1, 20000 } } );
+      test.execute( Push { string( 4000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 1230 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 770 ) );
+      test.execute( ExpectCongestionWindow { 10000 } );
+      for ( unsigned i = 0; i < 2; i++ ) {
+        test.execute( Receive { { isn + 1, 20000 } } );
+        test.execute( ExpectNoSegment {} );
+      }
+      test.execute( Receive { { isn + 1, 20000 } } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 230 ).with_seqno( isn + 1001 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectCongestionWindow { 10000 } );
+      test.execute( ExpectMSS { 1000 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.mss = 1460;
+      cfg.mtu_probing = true;
+
+      TCPSenderTestHarness test { "Repeated timeouts fall back to the base MSS", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( Receive { { isn + 1, 20000 } } );
+      test.execute( Push { string( 1230, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 1230 ) );
+      test.execute( Receive { { isn + 1231, 20000 } } );
+      test.execute( ExpectMSS { 1230 } );
+      test.execute( Push { string( 1230, 'y' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 1230 ).with_seqno( isn + 1231 ) );
+      test.execute( Tick { cfg.rt_timeout } );
+      test.execute( ExpectMessage {}.with_payload_size( 1230 ) );
+      test.execute( Tick { 2UL * cfg.rt_timeout } );
+      test.execute( ExpectMessage {}.with_payload_size( 1230 ) );
+      test.execute( Tick { 4UL * cfg.rt_timeout } );
+      test.execute( ExpectMSS { 1000 } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1231 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 230 ).with_seqno( isn + 2231 ) );
+      test.execute( ExpectConsecutiveRetransmissions { 3 } );
+    }
+
+    {
+      // The MSS option survives serialization and parsing.
+      TCPSenderMessage sent { .seqno = Wrap32 { 1000 }, .SYN = true, .SACK_permitted = true, .MSS = 1460 };
+      TCPSegment segment { .message = { .sender = std::move( sent ), .receiver = TCPReceiverMessage {} } };
+      segment.compute_checksum( 0 );
+      const string wire = concat( serialize( segment ) );
+      if ( segment.header_length() != 20 + 4 + 4 or wire.size() != segment.header_length() ) {
+        throw runtime_error( "unexpected header length " + to_string( segment.header_length() ) );
+      }
+
+      TCPSegment parsed;
+      if ( not parse( parsed, vector<string> { wire }, 0 ) ) {
+        throw runtime_error( "could not parse a segment with an MSS option" );
+      }
+      if ( parsed.message.sender->MSS != 1460 or not parsed.message.sender->SACK_permitted ) {
+        throw runtime_error( "options did not round-trip: " + parsed.to_string() );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
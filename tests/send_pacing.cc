@@ -0,0 +1,158 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "Without pacing, the whole window goes out at once", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( Receive { { isn + 1, 10000 } } );
+      test.execute( Push { string( 5000, 'x' ) } );
+      for ( unsigned i = 0; i < 5; i++ ) {
+        test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 + i * 1000 ) );
+      }
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectNextSend { nullopt } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.pacing = true;
+      cfg.pacing_rate = 1000000; // one segment per millisecond
+
+      TCPSenderTestHarness test { "A fixed pacing rate releases a segment per millisecond after a burst", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( ExpectNextSend { nullopt } );
+      test.execute( Receive { { isn + 1, 10000 } } );
+      test.execute( Push { string( 5000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1001 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 2000 } );
+      test.execute( ExpectNextSend { 1 } );
+      for ( unsigned i = 2; i < 5; i++ ) {
+        test.execute( Tick { 1 } );
+        test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 + i * 1000 ) );
+        test.execute( ExpectNoSegment {} );
+      }
+      test.execute( ExpectNextSend { nullopt } );
+      test.execute( ExpectSeqnosInFlight { 5000 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.pacing = true;
+      cfg.pacing_rate = 1000000;
+
+      TCPSenderTestHarness test { "The burst is two segments of the current MSS", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( PeerMSS { 400 } );
+      test.execute( Receive { { isn + 1, 10000 } } );
+      test.execute( Push { string( 5000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 400 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 400 ).with_seqno( isn + 401 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 800 } );
+      test.execute( ExpectNextSend { 1 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.pacing = true;
+      cfg.pacing_rate = 1000000;
+
+      TCPSenderTestHarness test { "A paced FIN waits its turn", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( Receive { { isn + 1, 10000 } } );
+      test.execute( Push { string( 2000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_fin( false ) );
+      test.execute( Close {} );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectNextSend { 1 } );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectMessage {}.with_fin( true ).with_payload_size( 0 ).with_seqno( isn + 2001 ) );
+      test.execute( ExpectNextSend { nullopt } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.pacing = true;
+      cfg.congestion_control = TCPConfig::CongestionAlgorithm::NewReno;
+      cfg.adaptive_rto = true;
+
+      TCPSenderTestHarness test { "The pacing rate follows the congestion window and SRTT", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( Tick { 100 } );
+      test.execute( Receive { { isn + 1, UINT16_MAX } }.without_push() );
+      test.execute( ExpectSRTT { 100 } );
+      test.execute( ExpectCongestionWindow { 10000 } );
+      // In slow start: 2 * 10000 / 100 ms = 200 bytes per millisecond, after a burst of two segments
+      test.execute( Push { string( 5000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1001 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectNextSend { 1 } );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 2001 ) );
+      test.execute( ExpectNextSend { 5 } );
+      test.execute( Tick { 4 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectNextSend { 1 } );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 3001 ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.pacing = true;
+      cfg.congestion_control = TCPConfig::CongestionAlgorithm::NewReno;
+
+      TCPSenderTestHarness test { "Without an RTT estimate there is no rate to pace at", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( Receive { { isn + 1, UINT16_MAX } } );
+      test.execute( Push { string( 5000, 'x' ) } );
+      for ( unsigned i = 0; i < 5; i++ ) {
+        test.execute( ExpectMessage {}.with_payload_size( 1000 ) );
+      }
+      test.execute( ExpectNextSend { nullopt } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,179 @@
+#include "bench.hh"
+#include "exception.hh"
+#include "file_descriptor.hh"
+#include "helpers.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_sender.hh"
+
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <random>
+#include <span>
+#include <utility>
+
+using namespace std;
+using namespace std::chrono;
+
+// Drives the send path the way TCPMinnowSocket does over a TUN device: the application writes into the
+// outbound ByteStream, TCPSender::push() makes segments, and each one is wrapped in an IPv4 datagram,
+// serialized, and written with writev() (to /dev/null). Reports throughput and the number of times each
+// payload byte is copied after the application's write, as CSV or JSON (see bench.hh). Every payload,
+// retransmissions included (`loss` is the share of rounds that end in a timeout), is copied once out of the
+// stream; any payload bytes that reach writev() in a buffer other than the segment's own payload add to that.
+// Segments per kilobyte show what a larger MSS saves.
+//     ./tests/send_path_bench --format=json > send_path.json
+
+namespace {
+
+using bench::Sample;
+
+struct Config
+{
+  size_t write_size;  // bytes per application write
+  size_t mss;         // TCPConfig::mss
+  uint16_t window;    // the receiver's window
+  unsigned loss_rate; // one round in `loss_rate` ends in a retransmission timeout (0: never)
+};
+
+struct Result
+{
+  Sample sample;
+  uint64_t wire_payload_bytes; // payload bytes handed to writev(), retransmissions included
+  uint64_t copied_bytes;       // payload bytes copied after the application's write
+  uint64_t segments;           // segments handed to writev(), retransmissions included
+};
+
+Result run( const string& data, const Config& config, FileDescriptor& sink )
+{
+  TCPConfig tcp_config;
+  tcp_config.send_capacity = 1 << 20;
+  tcp_config.mss = config.mss;
+  TCPSender sender { ByteStream { tcp_config.send_capacity }, tcp_config };
+  TCPOverIPv4Adapter adapter;
+  Result result {};
+
+  // Headers are the only bytes that should reach writev() outside the payload's own buffer.
+  const auto transmit = [&]( const TCPSenderMessage& msg ) {
+    InternetDatagram datagram = adapter.wrap_tcp_in_ip( { .sender = Ref<TCPSenderMessage>::borrow( msg ),
+                                                          .receiver = TCPReceiverMessage {} } );
+    auto buffers = serialize_pooled( datagram );
+    uint64_t outside_payload = 0;
+    for ( const auto& buffer : buffers ) {
+      outside_payload += buffer.get().data() == msg.payload.data() ? 0 : buffer.get().size();
+    }
+    result.copied_bytes += outside_payload - IPv4Header::LENGTH - TCPSegment::HEADER_LENGTH;
+    result.copied_bytes += msg.payload.size(); // out of the stream, into the payload
+    result.wire_payload_bytes += msg.payload.size();
+    result.segments++;
+    sink.write( span { buffers } );
+    ChunkPool::local().release( std::move( buffers ) );
+    ChunkPool::local().release( std::move( datagram.payload ) );
+  };
+
+  Writer& writer = sender.writer();
+  const Reader& reader = as_const( sender ).reader();
+  uint64_t written = 0;
+  uint64_t rounds = 0;
+  const uint64_t allocations_before = bench::allocations();
+  const auto start_time = steady_clock::now();
+
+  while ( not reader.is_finished() or sender.sequence_numbers_in_flight() ) {
+    rounds++;
+    while ( written < data.size() and writer.available_capacity() ) {
+      const span<char> space = writer.reserve( min( config.write_size, data.size() - written ) );
+      memcpy( space.data(), data.data() + written, space.size() );
+      writer.commit( space.size() );
+      written += space.size();
+    }
+    if ( written == data.size() ) {
+      writer.close();
+    }
+
+    sender.push( transmit );
+    if ( config.loss_rate and rounds % config.loss_rate == 0 ) {
+      sender.tick( sender.current_RTO_ms(), transmit ); // the first segment in flight goes out again
+    }
+    sender.receive( { .ackno = sender.make_empty_message().seqno, .window_size = config.window } );
+  }
+  const auto stop_time = steady_clock::now();
+
+  result.sample = { duration_cast<duration<double>>( stop_time - start_time ).count(),
+                    data.size(),
+                    rounds,
+                    bench::allocations() - allocations_before };
+  return result;
+}
+
+void program_body( const bench::Options& options )
+{
+  const string data = [&] {
+    default_random_engine rd { 2020 };
+    uniform_int_distribution<char> ud;
+    string ret( options.bytes, 0 );
+    ranges::generate( ret, [&] { return ud( rd ); } );
+    return ret;
+  }();
+
+  FileDescriptor sink { CheckSystemCall( "open /dev/null", open( "/dev/null", O_WRONLY | O_CLOEXEC ) ) };
+  bench::Report report { "send_path", options };
+
+  const vector<size_t> write_sizes
+    = options.quick ? vector<size_t> { 16384 } : vector<size_t> { 1000, 16384, 65536 };
+  const vector<uint16_t> windows = options.quick ? vector<uint16_t> { 64000 } : vector<uint16_t> { 8000, 64000 };
+  const vector<size_t> mss_sizes = options.quick ? vector<size_t> { 1000 } : vector<size_t> { 1000, 1460, 8960 };
+  const vector<unsigned> loss_rates = options.quick ? vector<unsigned> { 0, 50 } : vector<unsigned> { 0, 100, 10 };
+
+  for ( const auto write_size : write_sizes ) {
+    for ( const auto window : windows ) {
+      for ( const auto mss : mss_sizes ) {
+        for ( const auto loss_rate : loss_rates ) {
+          const Config config { write_size, mss, window, loss_rate };
+          vector<Sample> samples;
+          uint64_t wire_payload_bytes = 0;
+          uint64_t copied_bytes = 0;
+          uint64_t segments = 0;
+          for ( size_t i = 0; i < options.repeat; i++ ) {
+            const auto result = run( data, config, sink );
+            samples.push_back( result.sample );
+            wire_payload_bytes += result.wire_payload_bytes;
+            copied_bytes += result.copied_bytes;
+            segments += result.segments;
+          }
+
+          const auto bytes_sent = static_cast<double>( data.size() * options.repeat );
+          report.add(
+            { { "write_size", std::to_string( write_size ) },
+              { "window", std::to_string( window ) },
+              { "mss", std::to_string( mss ) },
+              { "loss_rate", loss_rate ? "1/" + std::to_string( loss_rate ) : "none" } },
+            samples,
+            { { "wire_bytes_per_byte",
+                bench::Report::fmt( static_cast<double>( wire_payload_bytes ) / bytes_sent ) },
+              { "copies_per_byte_sent",
+                bench::Report::fmt( static_cast<double>( copied_bytes )
+                                    / static_cast<double>( wire_payload_bytes ) ) },
+              { "segments_per_kb", bench::Report::fmt( 1000 * static_cast<double>( segments ) / bytes_sent ) } } );
+        }
+      }
+    }
+  }
+
+  report.print( cout );
+}
+} // namespace
+
+int main( int argc, char** argv )
+{
+  try {
+    if ( argc <= 0 ) {
+      abort();
+    }
+    program_body( bench::Options::parse( { argv, static_cast<size_t>( argc ) } ) );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,100 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.adaptive_rto = true;
+      cfg.min_rto_ms = 1;
+
+      TCPSenderTestHarness test { "RTO follows the measured RTT", cfg };
+      test.execute( ExpectRTO { TCPConfig::TIMEOUT_DFLT } );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( Tick { 40 } );
+      test.execute( AckReceived { isn + 1 } );
+      // SRTT = 40, RTTVAR = 20
+      test.execute( ExpectSRTT { 40 } );
+      test.execute( ExpectRTO { 120 } );
+
+      test.execute( Push { "abc" } );
+      test.execute( ExpectMessage {}.with_data( "abc" ) );
+      test.execute( Tick { 80 } );
+      test.execute( AckReceived { isn + 4 } );
+      // RTTVAR = 3/4 * 20 + 1/4 * 40 = 25, SRTT = 7/8 * 40 + 1/8 * 80 = 45
+      test.execute( ExpectSRTT { 45 } );
+      test.execute( ExpectRTO { 145 } );
+
+      test.execute( Push { "def" } );
+      test.execute( ExpectMessage {}.with_data( "def" ) );
+      test.execute( Tick { 144 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectMessage {}.with_data( "def" ) );
+      test.execute( ExpectRTO { 290 } );
+
+      // Karn's rule: the ack of a retransmitted segment isn't a sample, but it does end the backoff.
+      test.execute( Tick { 500 } );
+      test.execute( ExpectMessage {}.with_data( "def" ) );
+      test.execute( AckReceived { isn + 7 } );
+      test.execute( ExpectSRTT { 45 } );
+      test.execute( ExpectRTO { 145 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.adaptive_rto = true;
+
+      TCPSenderTestHarness test { "RTO respects the minimum", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( Tick { 2 } );
+      test.execute( AckReceived { isn + 1 } );
+      test.execute( ExpectSRTT { 2 } );
+      test.execute( ExpectRTO { TCPConfig::MIN_RTO_DFLT } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.rt_timeout = 100;
+      cfg.adaptive_rto = true;
+      cfg.max_rto_ms = 300;
+
+      TCPSenderTestHarness test { "Backoff stops at the maximum RTO", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( Tick { 100 } );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( ExpectRTO { 200 } );
+      test.execute( Tick { 200 } );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( ExpectRTO { 300 } );
+      test.execute( Tick { 300 } );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( ExpectRTO { 300 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,104 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.sack = true;
+
+      TCPSenderTestHarness test { "SYN offers SACK when configured", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_sack_permitted( true ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "SYN doesn't offer SACK by default", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_sack_permitted( false ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.sack = true;
+      cfg.congestion_control = TCPConfig::CongestionAlgorithm::NewReno;
+
+      TCPSenderTestHarness test { "Two holes in one window are retransmitted together", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( Receive { { isn + 1, 4000 } } );
+      for ( const string data : { "abcd", "efgh", "ijkl", "mnop", "qrst", "uvwx" } ) {
+        test.execute( Push { data } );
+        test.execute( ExpectMessage {}.with_data( data ) );
+      }
+
+      // "abcd" and "ijkl" are lost; SACKs for the rest arrive.
+      test.execute( Receive { { isn + 1, 4000 } }.with_sack( isn + 5, isn + 9 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Receive { { isn + 1, 4000 } }.with_sack( isn + 13, isn + 17 ).with_sack( isn + 5, isn + 9 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Receive { { isn + 1, 4000 } }.with_sack( isn + 13, isn + 25 ).with_sack( isn + 5, isn + 9 ) );
+      test.execute( ExpectMessage {}.with_data( "abcd" ).with_seqno( isn + 1 ) );
+      test.execute( ExpectMessage {}.with_data( "ijkl" ).with_seqno( isn + 9 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectCongestionWindow { 2000 } );
+      test.execute( ExpectSeqnosInFlight { 24 } );
+
+      test.execute( Receive { { isn + 25, 4000 } } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 0 } );
+      test.execute( ExpectConsecutiveRetransmissions { 0 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.sack = true;
+
+      TCPSenderTestHarness test { "A hole with too few SACKs above it is retransmitted on the partial ack", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( Receive { { isn + 1, 4000 } } );
+      for ( const string data : { "abcd", "efgh", "ijkl", "mnop", "qrst" } ) {
+        test.execute( Push { data } );
+        test.execute( ExpectMessage {}.with_data( data ) );
+      }
+
+      // "abcd" and "mnop" are lost.
+      test.execute( Receive { { isn + 1, 4000 } }.with_sack( isn + 5, isn + 13 ) );
+      test.execute( Receive { { isn + 1, 4000 } }.with_sack( isn + 17, isn + 21 ).with_sack( isn + 5, isn + 13 ) );
+      test.execute( ExpectMessage {}.with_data( "abcd" ).with_seqno( isn + 1 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Receive { { isn + 13, 4000 } }.with_sack( isn + 17, isn + 21 ) );
+      test.execute( ExpectMessage {}.with_data( "mnop" ).with_seqno( isn + 13 ) );
+      test.execute( Receive { { isn + 21, 4000 } } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 0 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
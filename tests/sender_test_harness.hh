@@ -18,6 +18,7 @@ struct SenderAndOutput
 {
   TCPSender sender;
   std::queue<TCPSenderMessage> output {};
+  size_t max_payload_size = TCPConfig::MAX_PAYLOAD_SIZE;
 
   auto make_transmit()
   {
@@ -55,7 +56,8 @@ public:
   TCPSenderTestHarness( std::string name, TCPConfig config )
     : TestHarness( move( name ),
                    "initial_RTO_ms=" + to_string( config.rt_timeout ) + " and ISN=" + to_string( config.isn ),
-                   { .sender = TCPSender { ByteStream { config.send_capacity }, config.isn, config.rt_timeout } } )
+                   { .sender = TCPSender { ByteStream { config.send_capacity }, config },
+                     .max_payload_size = config.mss } )
   {}
 
   template<std::derived_from<TestStep<TCPSender>> T>
@@ -104,6 +106,57 @@ struct ExpectConsecutiveRetransmissions : public ExpectNumber<TCPSender, uint64_
   uint64_t value( const TCPSender& sender ) const override { return sender.consecutive_retransmissions(); }
 };
 
+struct ExpectRTO : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "current_RTO_ms"; }
+  uint64_t value( const TCPSender& sender ) const override { return sender.current_RTO_ms(); }
+};
+
+struct ExpectSRTT : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "srtt_ms"; }
+  uint64_t value( const TCPSender& sender ) const override
+  {
+    if ( not sender.srtt_ms().has_value() ) {
+      throw ExpectationViolation( "srtt_ms() should have had a value" );
+    }
+    return sender.srtt_ms().value();
+  }
+};
+
+struct ExpectNextSend : public ExpectNumber<TCPSender, std::optional<uint64_t>>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "ms_until_next_send"; }
+  std::optional<uint64_t> value( const TCPSender& sender ) const override { return sender.ms_until_next_send(); }
+};
+
+struct ExpectMSS : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "mss"; }
+  uint64_t value( const TCPSender& sender ) const override { return sender.mss(); }
+};
+
+struct ExpectCongestionWindow : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "congestion_control()->window()"; }
+  uint64_t value( const TCPSender& sender ) const override { return sender.congestion_control()->window(); }
+};
+
+struct ExpectSlowStartThreshold : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "congestion_control()->slow_start_threshold()"; }
+  uint64_t value( const TCPSender& sender ) const override
+  {
+    return sender.congestion_control()->slow_start_threshold();
+  }
+};
+
 struct ExpectNoSegment : public Expectation<SenderAndOutput>
 {
   std::string description() const override { return "nothing to send"; }
@@ -222,19 +275,29 @@ struct Receive : public Action<SenderAndOutput>
   std::string description() const override
   {
     std::ostringstream desc;
-    desc << "receive(ack=" << to_string( msg_.ackno ) << ", win=" << msg_.window_size << ")";
+    desc << "receive(ack=" << to_string( msg_.ackno ) << ", win=" << msg_.window_size;
+    for ( const auto& block : msg_.sack_blocks() ) {
+      desc << ", sack=" << to_string( block.begin ) << "-" << to_string( block.end );
+    }
+    desc << ")";
     if ( push_ ) {
       desc << ", then push";
     }
     return desc.str();
   }
 
-  Receive& with_win( uint16_t win )
+  Receive& with_win( uint32_t win )
   {
     msg_.window_size = win;
     return *this;
   }
 
+  Receive& with_sack( Wrap32 begin, Wrap32 end )
+  {
+    msg_.add_sack_block( { begin, end } );
+    return *this;
+  }
+
   void execute( SenderAndOutput& ss ) const override
   {
     ss.sender.receive( msg_ );
@@ -262,6 +325,29 @@ struct Close : public Push
   Close() : Push( "" ) { with_close(); }
 };
 
+struct PeerMSS : public Action<SenderAndOutput>
+{
+  uint64_t mss_;
+  explicit PeerMSS( uint64_t mss ) : mss_( mss ) {}
+  std::string description() const override { return "peer's MSS is " + std::to_string( mss_ ); }
+  void execute( SenderAndOutput& ss ) const override { ss.sender.set_peer_mss( mss_ ); }
+  constexpr std::string obj() const override { return "TCPSender"; }
+};
+
+struct Cork : public Action<SenderAndOutput>
+{
+  std::string description() const override { return "cork"; }
+  void execute( SenderAndOutput& ss ) const override { ss.sender.cork(); }
+  constexpr std::string obj() const override { return "TCPSender"; }
+};
+
+struct Uncork : public Action<SenderAndOutput>
+{
+  std::string description() const override { return "uncork"; }
+  void execute( SenderAndOutput& ss ) const override { ss.sender.uncork( ss.make_transmit() ); }
+  constexpr std::string obj() const override { return "TCPSender"; }
+};
+
 class MessageExpectationViolation : public ExpectationViolation
 {
 public:
@@ -280,11 +366,13 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
   std::optional<bool> syn {};
   std::optional<bool> fin {};
   std::optional<bool> rst {};
+  std::optional<bool> sack_permitted {};
+  std::optional<uint16_t> mss {};
   std::optional<Wrap32> seqno {};
   std::optional<std::string> data {};
   std::optional<size_t> payload_size {};
 
-  bool empty() const { return not( syn or fin or rst or seqno or data or payload_size ); }
+  bool empty() const { return not( syn or fin or rst or sack_permitted or mss or seqno or data or payload_size ); }
 
   ExpectMessage& with_syn( bool syn_ )
   {
@@ -310,6 +398,18 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
     return *this;
   }
 
+  ExpectMessage& with_sack_permitted( bool sack_permitted_ )
+  {
+    sack_permitted = sack_permitted_;
+    return *this;
+  }
+
+  ExpectMessage& with_mss( uint16_t mss_ )
+  {
+    mss = mss_;
+    return *this;
+  }
+
   ExpectMessage& with_seqno( Wrap32 seqno_ )
   {
     seqno = seqno_;
@@ -361,6 +461,12 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
     if ( rst.has_value() ) {
       o << ( rst.value() ? " +RST" : " -RST" );
     }
+    if ( sack_permitted.has_value() ) {
+      o << ( sack_permitted.value() ? " +SACK_PERM" : " -SACK_PERM" );
+    }
+    if ( mss.has_value() ) {
+      o << " MSS=" << mss.value();
+    }
     return o.str();
   }
 
@@ -377,10 +483,13 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
 
     const TCPSenderMessage seg = ss.expect_message();
 
-    if ( seg.payload.size() > TCPConfig::MAX_PAYLOAD_SIZE ) {
+    if ( seg.payload.size() > ss.max_payload_size ) {
       throw ExpectationViolation( "sent a message with a " + std::to_string( seg.payload.size() )
                                   + "-byte payload, which is longer than the maximum ("
-                                  + std::to_string( TCPConfig::MAX_PAYLOAD_SIZE ) + ")" );
+                                  + std::to_string( ss.max_payload_size ) + ")" );
+    }
+    if ( mss.has_value() and seg.MSS != mss.value() ) {
+      throw MessageExpectationViolation( seg, "MSS", mss.value(), seg.MSS );
     }
     if ( syn.has_value() and seg.SYN != syn.value() ) {
       throw MessageExpectationViolation( seg, "SYN flag", syn.value(), seg.SYN );
@@ -391,6 +500,9 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
     if ( rst.has_value() and seg.RST != rst.value() ) {
       throw MessageExpectationViolation( seg, "RST flag", rst.value(), seg.RST );
     }
+    if ( sack_permitted.has_value() and seg.SACK_permitted != sack_permitted.value() ) {
+      throw MessageExpectationViolation( seg, "SACK_permitted", sack_permitted.value(), seg.SACK_permitted );
+    }
     if ( seqno.has_value() and seg.seqno != seqno.value() ) {
       throw MessageExpectationViolation( seg, "sequence number", seqno.value(), seg.seqno );
     }
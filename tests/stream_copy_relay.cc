@@ -0,0 +1,154 @@
+#include "bidirectional_stream_copy.hh"
+#include "exception.hh"
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <random>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+string random_bytes( size_t len, unsigned int seed )
+{
+  default_random_engine rd { seed };
+  uniform_int_distribution<char> ud;
+  string ret( len, '\0' );
+  for ( auto& c : ret ) {
+    c = ud( rd );
+  }
+  return ret;
+}
+
+pair<FileDescriptor, FileDescriptor> make_pipe()
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "pipe2", ::pipe2( fds.data(), O_CLOEXEC ) );
+  return { FileDescriptor { fds[0] }, FileDescriptor { fds[1] } };
+}
+
+// bidirectional_stream_copy() closes stdin and stdout when it is done: reopen them (on /dev/null) so that
+// the descriptors created for the next test don't take their numbers.
+void reopen_std_fds()
+{
+  for ( const int target : { STDIN_FILENO, STDOUT_FILENO } ) {
+    if ( fcntl( target, F_GETFD ) < 0 ) { // NOLINT(*-vararg)
+      const int fd = CheckSystemCall( "open", open( "/dev/null", O_RDWR ) ); // NOLINT(*-vararg)
+      if ( fd != target ) {
+        CheckSystemCall( "dup2", dup2( fd, target ) );
+        CheckSystemCall( "close", close( fd ) );
+      }
+    }
+  }
+}
+
+// Put `fd` in place of stdin or stdout, where bidirectional_stream_copy() looks for them.
+void install( const FileDescriptor& fd, int target )
+{
+  CheckSystemCall( "dup2", dup2( fd.fd_num(), target ) );
+}
+
+string read_all( FileDescriptor& fd )
+{
+  string ret;
+  string buffer;
+  while ( not fd.eof() ) {
+    buffer.clear();
+    fd.read( buffer );
+    ret += buffer;
+  }
+  return ret;
+}
+
+// Relay `outbound` from stdin to the peer and `inbound` from the peer to stdout, with stdin fed slowly in small
+// pieces so the relay often finds it empty. If `output_file` is given, stdout is that file opened O_APPEND,
+// which splice(2) refuses (EINVAL); otherwise stdout is a pipe.
+void relay_test( const string& test_name, const string& outbound, const string& inbound, const char* output_file )
+{
+  reopen_std_fds();
+
+  array<int, 2> socket_fds {};
+  CheckSystemCall( "socketpair", socketpair( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, socket_fds.data() ) );
+  LocalStreamSocket relay_socket { FileDescriptor { socket_fds[0] } };
+  LocalStreamSocket peer { FileDescriptor { socket_fds[1] } };
+
+  auto [stdin_read, stdin_write] = make_pipe();
+  install( stdin_read, STDIN_FILENO );
+  stdin_read.close();
+
+  optional<FileDescriptor> stdout_read;
+  if ( output_file ) {
+    FileDescriptor file { CheckSystemCall(
+      "open", open( output_file, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0600 ) ) }; // NOLINT
+    install( file, STDOUT_FILENO );
+  } else {
+    auto [read_end, write_end] = make_pipe();
+    install( write_end, STDOUT_FILENO );
+    stdout_read = move( read_end );
+  }
+
+  thread slow_source( [&] {
+    constexpr size_t piece = 1000;
+    for ( size_t i = 0; i < outbound.size(); i += piece ) {
+      stdin_write.write_all( string_view { outbound }.substr( i, piece ) );
+      this_thread::sleep_for( chrono::microseconds( 200 ) );
+    }
+    stdin_write.close();
+  } );
+
+  string peer_received;
+  thread peer_side( [&] {
+    peer.write_all( inbound );
+    peer.shutdown( SHUT_WR );
+    peer_received = read_all( peer );
+  } );
+
+  string output;
+  thread output_side( [&] {
+    if ( stdout_read ) {
+      output = read_all( *stdout_read );
+    }
+  } );
+
+  bidirectional_stream_copy( relay_socket, "peer" );
+  slow_source.join();
+  peer_side.join();
+  output_side.join();
+
+  if ( output_file ) {
+    FileDescriptor file { CheckSystemCall( "open", open( output_file, O_RDONLY | O_CLOEXEC ) ) }; // NOLINT
+    output = read_all( file );
+    unlink( output_file );
+  }
+
+  if ( peer_received != outbound ) {
+    throw runtime_error( test_name + ": peer received " + to_string( peer_received.size() ) + " of "
+                         + to_string( outbound.size() ) + " bytes (or the wrong bytes)" );
+  }
+  if ( output != inbound ) {
+    throw runtime_error( test_name + ": stdout received " + to_string( output.size() ) + " of "
+                         + to_string( inbound.size() ) + " bytes (or the wrong bytes)" );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    relay_test( "splice relay with a slow source", random_bytes( 200000, 1 ), random_bytes( 3000000, 2 ), nullptr );
+    relay_test( "splice relay falls back for an O_APPEND file",
+                random_bytes( 200000, 3 ),
+                random_bytes( 3000000, 4 ),
+                "stream_copy_relay.out" );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
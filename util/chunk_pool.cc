@@ -0,0 +1,73 @@
+#include "chunk_pool.hh"
+
+#include <algorithm>
+
+using namespace std;
+
+ChunkPool& ChunkPool::local()
+{
+  thread_local ChunkPool pool;
+  return pool;
+}
+
+string ChunkPool::acquire( size_t size_hint )
+{
+  stats_.outstanding_peak = max( stats_.outstanding_peak, ++stats_.outstanding );
+
+  // smallest class that fits
+  const auto cls = ranges::lower_bound( SIZE_CLASSES, size_hint );
+  if ( cls == SIZE_CLASSES.end() ) {
+    ++stats_.misses;
+    string ret;
+    ret.reserve( size_hint );
+    return ret;
+  }
+
+  auto& list = free_.at( cls - SIZE_CLASSES.begin() );
+  if ( list.empty() ) {
+    ++stats_.misses;
+    string ret;
+    ret.reserve( *cls );
+    return ret;
+  }
+
+  ++stats_.hits;
+  string ret = move( list.back() );
+  list.pop_back();
+  stats_.cached_bytes -= ret.capacity();
+  return ret;
+}
+
+void ChunkPool::release( string&& chunk )
+{
+  stats_.outstanding -= min( stats_.outstanding, uint64_t { 1 } );
+
+  // largest class the buffer can serve
+  const auto cls = ranges::upper_bound( SIZE_CLASSES, chunk.capacity() );
+  if ( cls == SIZE_CLASSES.begin() or chunk.capacity() > 2 * SIZE_CLASSES.back() ) {
+    ++stats_.discards;
+    return;
+  }
+
+  auto& list = free_.at( cls - SIZE_CLASSES.begin() - 1 );
+  if ( list.size() >= MAX_CACHED_PER_CLASS ) {
+    ++stats_.discards;
+    return;
+  }
+
+  ++stats_.releases;
+  chunk.clear();
+  stats_.cached_bytes += chunk.capacity();
+  stats_.cached_bytes_peak = max( stats_.cached_bytes_peak, stats_.cached_bytes );
+  list.push_back( move( chunk ) );
+}
+
+void ChunkPool::release( vector<Ref<string>>&& chunks )
+{
+  for ( auto& chunk : chunks ) {
+    if ( chunk.is_owned() ) {
+      release( chunk.release() );
+    }
+  }
+  chunks.clear();
+}
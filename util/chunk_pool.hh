@@ -0,0 +1,50 @@
+#pragma once
+
+#include "ref.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//! A per-thread, size-classed cache of string buffers, so the hot paths that build
+//! short-lived buffers (segment payloads, serialized headers) can reuse memory instead
+//! of doing a malloc/free pair per packet.
+class ChunkPool
+{
+public:
+  //! Buffer capacities handed out by acquire(); requests larger than the last class bypass the pool
+  static constexpr std::array<size_t, 6> SIZE_CLASSES { 64, 256, 1024, 4096, 16384, 65536 };
+  static constexpr size_t MAX_CACHED_PER_CLASS = 256; //!< Released buffers beyond this are freed
+
+  struct Stats
+  {
+    uint64_t hits {};               //!< acquire() served from the cache
+    uint64_t misses {};             //!< acquire() had to allocate
+    uint64_t releases {};           //!< buffers returned and kept for reuse
+    uint64_t discards {};           //!< buffers returned but freed (too small, too big, or class full)
+    uint64_t outstanding {};        //!< buffers acquired from this thread's pool and not yet released
+    uint64_t outstanding_peak {};   //!< high-water mark of `outstanding`
+    uint64_t cached_bytes {};       //!< capacity currently held in the cache
+    uint64_t cached_bytes_peak {};  //!< high-water mark of `cached_bytes`
+  };
+
+  //! The calling thread's pool
+  static ChunkPool& local();
+
+  //! An empty string with capacity for at least `size_hint` bytes
+  std::string acquire( size_t size_hint );
+
+  //! Return a buffer (any string, not only one from acquire()) so its memory can be reused
+  void release( std::string&& chunk );
+
+  //! Return every owned buffer in a serialized payload (borrowed ones are left alone)
+  void release( std::vector<Ref<std::string>>&& chunks );
+
+  const Stats& stats() const { return stats_; }
+
+private:
+  std::array<std::vector<std::string>, SIZE_CLASSES.size()> free_ {};
+  Stats stats_ {};
+};
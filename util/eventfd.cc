@@ -0,0 +1,25 @@
+#include "eventfd.hh"
+#include "exception.hh"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <sys/eventfd.h>
+
+using namespace std;
+
+EventFD::EventFD() : FileDescriptor( ::CheckSystemCall( "eventfd", eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) ) ) {}
+
+void EventFD::notify()
+{
+  static constexpr uint64_t increment = 1;
+  array<char, sizeof( increment )> raw {};
+  memcpy( raw.data(), &increment, sizeof( increment ) );
+  write( string_view { raw.data(), raw.size() } );
+}
+
+bool EventFD::clear()
+{
+  array<char, sizeof( uint64_t )> raw {};
+  return read( span<char> { raw } ) == raw.size();
+}
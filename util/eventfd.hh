@@ -0,0 +1,18 @@
+#pragma once
+
+#include "file_descriptor.hh"
+
+//! A FileDescriptor to a non-blocking [eventfd](\ref man2::eventfd) counter, used to wake up an EventLoop
+//! (or any poll(2) caller) when another thread or component has something for it to do
+class EventFD : public FileDescriptor
+{
+public:
+  //! Create a new eventfd with its counter at zero
+  EventFD();
+
+  //! Make the eventfd readable (increments the counter)
+  void notify();
+
+  //! Reset the counter to zero; returns true if the eventfd had been notified
+  bool clear();
+};
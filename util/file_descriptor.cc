@@ -100,6 +100,16 @@ void FileDescriptor::read( string& buffer )
     buffer.resize( kReadBufferSize );
   }
 
+  buffer.resize( read( span<char> { buffer } ) );
+}
+
+// Read into a single non-empty span without allocating or resizing anything.
+size_t FileDescriptor::read( span<char> buffer )
+{
+  if ( buffer.empty() ) {
+    throw runtime_error( "FileDescriptor::read called with empty buffer" );
+  }
+
   const size_t bytes_read = CheckRead( "read", ::read( fd_num(), buffer.data(), buffer.size() ) );
   register_read();
 
@@ -107,7 +117,7 @@ void FileDescriptor::read( string& buffer )
     throw runtime_error( "read() read more than requested" );
   }
 
-  buffer.resize( bytes_read );
+  return bytes_read;
 }
 
 // Read into a vector of buffers (if all empty, the last one will be resized to a reasonable value).
@@ -144,6 +154,21 @@ void FileDescriptor::read( vector<string>& buffers )
   }
 }
 
+size_t FileDescriptor::splice( FileDescriptor& destination, size_t len )
+{
+  const size_t bytes_moved = CheckRead(
+    "splice",
+    ::splice( fd_num(), nullptr, destination.fd_num(), nullptr, len, SPLICE_F_MOVE | SPLICE_F_NONBLOCK ) );
+  register_read();
+  destination.register_write();
+
+  if ( bytes_moved > len ) {
+    throw runtime_error( "splice moved more than requested" );
+  }
+
+  return bytes_moved;
+}
+
 void FileDescriptor::write_all( string_view buffer )
 {
   if ( not blocking() ) {
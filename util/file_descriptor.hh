@@ -5,6 +5,7 @@
 #include <bits/types/struct_iovec.h>
 #include <cstddef>
 #include <memory>
+#include <span>
 #include <vector>
 
 // A reference-counted handle to a file descriptor
@@ -18,6 +19,9 @@ public:
   void read( std::string& buffer );
   void read( std::vector<std::string>& buffers );
 
+  // Read directly into caller-owned memory (e.g. Writer::reserve()) and return the number of bytes read
+  size_t read( std::span<char> buffer );
+
   // `write_all` writes a buffer completely.
   void write_all( std::string_view buffer );
 
@@ -30,6 +34,10 @@ public:
     return write( iovecs, total_size );
   }
 
+  // Move up to `len` bytes from this file descriptor into `destination` without copying them through user
+  // space (see [splice(2)](\ref man2::splice); one of the two must be a pipe). Returns the number of bytes moved.
+  size_t splice( FileDescriptor& destination, size_t len );
+
   // Close the underlying file descriptor
   void close() { internal_fd_->close(); }
 
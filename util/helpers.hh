@@ -1,5 +1,6 @@
 #pragma once
 
+#include "chunk_pool.hh"
 #include "ethernet_frame.hh"
 #include "ipv4_datagram.hh"
 #include "parser.hh"
@@ -20,6 +21,16 @@ std::vector<Ref<std::string>> serialize( const T& obj )
   return s.finish();
 }
 
+// Like serialize(), but builds the header bytes in chunks from this thread's ChunkPool. The caller must give
+// them back once the buffers have been written: ```ChunkPool::local().release( std::move( buffers ) );```
+template<class T>
+std::vector<Ref<std::string>> serialize_pooled( const T& obj )
+{
+  Serializer s { ChunkPool::local() };
+  obj.serialize( s );
+  return s.finish();
+}
+
 // Helper to parse any object (without constructing a Parser of the caller's own). Returns true if successful.
 // example:
 //   ```
@@ -1,5 +1,6 @@
 #include "ipv4_header.hh"
 #include "checksum.hh"
+#include "chunk_pool.hh"
 
 #include <arpa/inet.h>
 #include <sstream>
@@ -105,13 +106,15 @@ uint32_t IPv4Header::pseudo_checksum() const
 void IPv4Header::compute_checksum()
 {
   cksum = 0;
-  Serializer s;
+  Serializer s { ChunkPool::local() };
   serialize( s );
 
   // calculate checksum -- taken over header only
+  auto buffers = s.finish();
   InternetChecksum check;
-  check.add( s.finish() );
+  check.add( buffers );
   cksum = check.value();
+  ChunkPool::local().release( move( buffers ) );
 }
 
 string IPv4Header::to_string() const
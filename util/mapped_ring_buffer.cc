@@ -0,0 +1,114 @@
+#include "mapped_ring_buffer.hh"
+#include "exception.hh"
+
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utility>
+
+using namespace std;
+
+size_t MappedRingBuffer::page_size()
+{
+  static const size_t size = CheckSystemCall( "sysconf", static_cast<int>( sysconf( _SC_PAGESIZE ) ) );
+  return size;
+}
+
+MappedRingBuffer::MappedRingBuffer( size_t min_size )
+  : memfd_( FileDescriptor { CheckSystemCall( "memfd_create", memfd_create( "ByteStream", MFD_CLOEXEC ) ) } )
+  , size_( ( min_size + page_size() - 1 ) / page_size() * page_size() )
+{
+  if ( size_ == 0 ) {
+    throw runtime_error( "MappedRingBuffer requires a nonzero size" );
+  }
+  CheckSystemCall( "ftruncate", ftruncate( memfd_->fd_num(), static_cast<off_t>( size_ ) ) );
+
+  // Reserve 2 * size_ of address space, then map the memfd over each half.
+  void* reserved = mmap( nullptr, 2 * size_, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+  if ( reserved == MAP_FAILED ) {
+    throw unix_error { "mmap" };
+  }
+  base_ = static_cast<char*>( reserved );
+
+  for ( char* half : { base_, base_ + size_ } ) {
+    if ( mmap( half, size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, memfd_->fd_num(), 0 ) == MAP_FAILED ) {
+      const unix_error error { "mmap" };
+      unmap();
+      throw error;
+    }
+  }
+}
+
+MappedRingBuffer::MappedRingBuffer( const MappedRingBuffer& other ) : MappedRingBuffer()
+{
+  if ( other.size_ ) {
+    MappedRingBuffer copy { other.size_ };
+    memcpy( copy.base_, other.base_, other.size_ );
+    *this = move( copy );
+  }
+}
+
+MappedRingBuffer& MappedRingBuffer::operator=( const MappedRingBuffer& other )
+{
+  if ( this != &other ) {
+    *this = MappedRingBuffer { other };
+  }
+  return *this;
+}
+
+MappedRingBuffer::MappedRingBuffer( MappedRingBuffer&& other ) noexcept
+  : memfd_( move( other.memfd_ ) ), base_( exchange( other.base_, nullptr ) ), size_( exchange( other.size_, 0 ) )
+{}
+
+MappedRingBuffer& MappedRingBuffer::operator=( MappedRingBuffer&& other ) noexcept
+{
+  if ( this != &other ) {
+    unmap();
+    memfd_ = move( other.memfd_ );
+    base_ = exchange( other.base_, nullptr );
+    size_ = exchange( other.size_, 0 );
+  }
+  return *this;
+}
+
+MappedRingBuffer::~MappedRingBuffer()
+{
+  unmap();
+}
+
+void MappedRingBuffer::unmap()
+{
+  if ( base_ and munmap( base_, 2 * size_ ) < 0 ) {
+    // don't throw from the destructor
+    cerr << "Exception destructing MappedRingBuffer: " << unix_error { "munmap" }.what() << "\n";
+  }
+  base_ = nullptr;
+  size_ = 0;
+  memfd_.reset();
+}
+
+void MappedRingBuffer::discard( size_t offset, size_t len )
+{
+  if ( len == 0 or not memfd_.has_value() ) {
+    return;
+  }
+
+  offset %= size_;
+  if ( offset + len > size_ ) {
+    discard( 0, offset + len - size_ );
+    len = size_ - offset;
+  }
+
+  // only whole pages can be released
+  const size_t begin = ( offset + page_size() - 1 ) / page_size() * page_size();
+  const size_t end = ( offset + len ) / page_size() * page_size();
+  if ( begin < end ) {
+    CheckSystemCall( "fallocate",
+                     fallocate( memfd_->fd_num(),
+                                FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                                static_cast<off_t>( begin ),
+                                static_cast<off_t>( end - begin ) ) );
+  }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "file_descriptor.hh"
+
+#include <cstddef>
+#include <optional>
+
+//! A ring of bytes backed by a [memfd](\ref man2::memfd_create) that is mapped twice, back to back,
+//! so that any run of up to size() bytes starting anywhere in the ring is contiguous in memory.
+//! The pages are shared memory: they can be swapped out under pressure, and discard() hands
+//! them back to the kernel as soon as their contents are no longer needed.
+class MappedRingBuffer
+{
+public:
+  MappedRingBuffer() = default;
+
+  //! Create a ring of at least `min_size` bytes (rounded up to a whole number of pages)
+  explicit MappedRingBuffer( size_t min_size );
+
+  //! Copies get their own memfd and mapping, with the same contents
+  MappedRingBuffer( const MappedRingBuffer& other );
+  MappedRingBuffer& operator=( const MappedRingBuffer& other );
+  MappedRingBuffer( MappedRingBuffer&& other ) noexcept;
+  MappedRingBuffer& operator=( MappedRingBuffer&& other ) noexcept;
+  ~MappedRingBuffer();
+
+  //! Start of the ring; addresses [data(), data() + 2 * size()) are valid and the second half mirrors the first
+  char* data() { return base_; }
+  const char* data() const { return base_; }
+
+  //! Size of the ring (zero if default-constructed)
+  size_t size() const { return size_; }
+
+  //! Return the whole pages within the ring offsets [offset, offset + len) to the kernel (they read back as zeros)
+  void discard( size_t offset, size_t len );
+
+  static size_t page_size();
+
+private:
+  std::optional<FileDescriptor> memfd_ {};
+  char* base_ {};
+  size_t size_ {};
+
+  void unmap();
+};
@@ -0,0 +1,167 @@
+#include "memory_budget.hh"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+MemoryBudget::MemoryBudget( uint64_t low, uint64_t pressure, uint64_t limit )
+  : low_( low ), pressure_( pressure ), limit_( limit )
+{
+  if ( low > pressure or pressure > limit ) {
+    throw runtime_error( "MemoryBudget thresholds must satisfy low <= pressure <= limit" );
+  }
+}
+
+void MemoryBudget::charge( uint64_t bytes )
+{
+  const uint64_t now = used_.fetch_add( bytes, memory_order_relaxed ) + bytes;
+  uint64_t peak = used_peak_.load( memory_order_relaxed );
+  while ( now > peak and not used_peak_.compare_exchange_weak( peak, now, memory_order_relaxed ) ) {}
+  update_state( now );
+}
+
+void MemoryBudget::release( uint64_t bytes )
+{
+  update_state( used_.fetch_sub( bytes, memory_order_relaxed ) - bytes );
+}
+
+// Above `limit` is Exhausted and above `pressure` is Pressure; between `low` and `pressure` the state
+// only steps down (from Exhausted to Pressure), and below `low` it returns to Normal.
+void MemoryBudget::update_state( uint64_t used )
+{
+  State current = state_.load( memory_order_relaxed );
+  while ( true ) {
+    State next = min( current, State::Pressure );
+    if ( used > limit_ ) {
+      next = State::Exhausted;
+    } else if ( used > pressure_ ) {
+      next = State::Pressure;
+    } else if ( used < low_ ) {
+      next = State::Normal;
+    }
+
+    if ( next == current ) {
+      return;
+    }
+    if ( state_.compare_exchange_weak( current, next, memory_order_relaxed ) ) {
+      if ( next == State::Exhausted ) {
+        exhausted_entered_.fetch_add( 1, memory_order_relaxed );
+      } else if ( next == State::Pressure and current == State::Normal ) {
+        pressure_entered_.fetch_add( 1, memory_order_relaxed );
+      }
+      return;
+    }
+  }
+}
+
+uint64_t MemoryBudget::excess() const
+{
+  const uint64_t now = used();
+  return now > pressure_ ? now - pressure_ : 0;
+}
+
+uint64_t MemoryBudget::clamp_window( uint64_t window ) const
+{
+  uint64_t allowed = window;
+  switch ( state() ) {
+    case State::Normal:
+      return window;
+    case State::Pressure: {
+      // Linear in the room left below `limit`, computed in floating point to avoid overflow.
+      const uint64_t now = min( used(), limit_ );
+      const double share
+        = limit_ > pressure_ ? static_cast<double>( limit_ - now ) / static_cast<double>( limit_ - pressure_ ) : 0;
+      allowed = static_cast<uint64_t>( static_cast<double>( window ) * min( share, 1.0 ) );
+      break;
+    }
+    case State::Exhausted:
+      allowed = 0;
+      break;
+  }
+  if ( allowed < window ) {
+    windows_clamped_.fetch_add( 1, memory_order_relaxed );
+  }
+  return allowed;
+}
+
+MemoryBudget::Stats MemoryBudget::stats() const
+{
+  return { used(),
+           used_peak_.load( memory_order_relaxed ),
+           state(),
+           pressure_entered_.load( memory_order_relaxed ),
+           exhausted_entered_.load( memory_order_relaxed ),
+           windows_clamped_.load( memory_order_relaxed ),
+           bytes_pruned_.load( memory_order_relaxed ),
+           bytes_refused_.load( memory_order_relaxed ) };
+}
+
+MemoryBudget::Charge::Charge( const Charge& other ) : budget_( other.budget_ ), amount_( other.amount_ )
+{
+  if ( budget_ ) {
+    budget_->charge( amount_ );
+  }
+}
+
+MemoryBudget::Charge& MemoryBudget::Charge::operator=( const Charge& other )
+{
+  if ( this != &other ) {
+    release_all();
+    budget_ = other.budget_;
+    amount_ = other.amount_;
+    if ( budget_ ) {
+      budget_->charge( amount_ );
+    }
+  }
+  return *this;
+}
+
+MemoryBudget::Charge::Charge( Charge&& other ) noexcept
+  : budget_( std::move( other.budget_ ) ), amount_( exchange( other.amount_, 0 ) )
+{}
+
+MemoryBudget::Charge& MemoryBudget::Charge::operator=( Charge&& other ) noexcept
+{
+  if ( this != &other ) {
+    release_all();
+    budget_ = std::move( other.budget_ );
+    amount_ = exchange( other.amount_, 0 );
+  }
+  return *this;
+}
+
+void MemoryBudget::Charge::attach( const shared_ptr<MemoryBudget>& budget )
+{
+  if ( budget == budget_ ) {
+    return;
+  }
+  if ( budget_ ) {
+    budget_->release( amount_ );
+  }
+  budget_ = budget;
+  if ( budget_ ) {
+    budget_->charge( amount_ );
+  }
+}
+
+void MemoryBudget::Charge::set( uint64_t bytes )
+{
+  if ( budget_ ) {
+    if ( bytes > amount_ ) {
+      budget_->charge( bytes - amount_ );
+    } else if ( bytes < amount_ ) {
+      budget_->release( amount_ - bytes );
+    }
+  }
+  amount_ = bytes;
+}
+
+void MemoryBudget::Charge::release_all()
+{
+  if ( budget_ ) {
+    budget_->release( amount_ );
+  }
+  amount_ = 0;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+//! A memory allowance shared by many connections, in the spirit of Linux's `tcp_mem`: ByteStream rings (which
+//! also hold a sender's unacknowledged bytes) and Reassembler pending rings charge their memory against it.
+//! Above the `pressure` threshold connections shrink their advertised windows and prune out-of-order data;
+//! above `limit` new out-of-order data is refused outright. Pressure ends once usage falls below `low`.
+//! Safe to share between threads.
+class MemoryBudget
+{
+public:
+  enum class State : uint8_t
+  {
+    Normal,
+    Pressure,
+    Exhausted
+  };
+
+  //! Counters describing how often the budget came under pressure and what it cost
+  struct Stats
+  {
+    uint64_t used {};              //!< bytes currently charged
+    uint64_t used_peak {};         //!< high-water mark of `used`
+    State state {};                //!< current state
+    uint64_t pressure_entered {};  //!< transitions into Pressure (from Normal)
+    uint64_t exhausted_entered {}; //!< transitions into Exhausted
+    uint64_t windows_clamped {};   //!< advertised windows shrunk by clamp_window()
+    uint64_t bytes_pruned {};      //!< held out-of-order bytes discarded to relieve pressure
+    uint64_t bytes_refused {};     //!< out-of-order bytes not stored because the budget was exhausted
+  };
+
+  //! Thresholds in bytes; requires low <= pressure <= limit
+  MemoryBudget( uint64_t low, uint64_t pressure, uint64_t limit );
+
+  void charge( uint64_t bytes );
+  void release( uint64_t bytes );
+
+  uint64_t used() const { return used_.load( std::memory_order_relaxed ); }
+  State state() const { return state_.load( std::memory_order_relaxed ); }
+
+  //! How far usage is above the pressure threshold (what pruning should aim to give back)
+  uint64_t excess() const;
+
+  //! The part of a `window`-byte receive window that may be advertised in the current state:
+  //! all of it when Normal, shrinking linearly to nothing between `pressure` and `limit`
+  uint64_t clamp_window( uint64_t window ) const;
+
+  void record_pruned( uint64_t bytes ) { bytes_pruned_.fetch_add( bytes, std::memory_order_relaxed ); }
+  void record_refused( uint64_t bytes ) { bytes_refused_.fetch_add( bytes, std::memory_order_relaxed ); }
+
+  Stats stats() const;
+
+  //! A number of bytes charged to a (possibly absent) budget, released on destruction. Copies charge
+  //! the budget again, so objects holding a Charge keep ordinary copy semantics.
+  class Charge
+  {
+  public:
+    Charge() = default;
+    ~Charge() { release_all(); }
+    Charge( const Charge& other );
+    Charge& operator=( const Charge& other );
+    Charge( Charge&& other ) noexcept;
+    Charge& operator=( Charge&& other ) noexcept;
+
+    //! Move the charge to `budget` (or to no budget at all)
+    void attach( const std::shared_ptr<MemoryBudget>& budget );
+
+    //! Change the charged amount to `bytes`
+    void set( uint64_t bytes );
+
+    const std::shared_ptr<MemoryBudget>& budget() const { return budget_; }
+    uint64_t amount() const { return amount_; }
+
+  private:
+    std::shared_ptr<MemoryBudget> budget_ {};
+    uint64_t amount_ {};
+
+    void release_all();
+  };
+
+private:
+  uint64_t low_, pressure_, limit_;
+
+  std::atomic<uint64_t> used_ {};
+  std::atomic<uint64_t> used_peak_ {};
+  std::atomic<State> state_ { State::Normal };
+  std::atomic<uint64_t> pressure_entered_ {};
+  std::atomic<uint64_t> exhausted_entered_ {};
+  mutable std::atomic<uint64_t> windows_clamped_ {};
+  std::atomic<uint64_t> bytes_pruned_ {};
+  std::atomic<uint64_t> bytes_refused_ {};
+
+  void update_state( uint64_t used );
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "chunk_pool.hh"
 #include "ref.hh"
 
 #include <concepts>
@@ -94,17 +95,36 @@ public:
 
 class Serializer
 {
+  static constexpr size_t HEADER_CHUNK_SIZE = 64;
+
   std::vector<Ref<std::string>> output_ {};
   std::string buffer_ {};
+  ChunkPool* pool_ {};
 
   void flush();
 
 public:
+  Serializer() = default;
+
+  // Build header bytes in chunks from `pool`. The caller owns the result of finish() and must hand it back
+  // with ChunkPool::release() once done with it.
+  explicit Serializer( ChunkPool& pool ) : pool_( &pool ) {}
+
+  Serializer( const Serializer& other ) = delete;
+  Serializer& operator=( const Serializer& other ) = delete;
+  Serializer( Serializer&& other ) = default;
+  Serializer& operator=( Serializer&& other ) = default;
+  ~Serializer() = default;
+
   template<std::unsigned_integral T>
   void integer( const T val )
   {
     constexpr uint64_t len = sizeof( T );
 
+    if ( pool_ and buffer_.empty() and buffer_.capacity() < HEADER_CHUNK_SIZE ) {
+      buffer_ = pool_->acquire( HEADER_CHUNK_SIZE );
+    }
+
     for ( uint64_t i = 0; i < len; ++i ) {
       const uint8_t byte_val = val >> ( ( len - i - 1 ) * 8 );
       buffer_.push_back( byte_val );
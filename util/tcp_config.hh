@@ -1,24 +1,79 @@
 #pragma once
 
 #include "address.hh"
+#include "memory_budget.hh"
 #include "wrapping_integers.hh"
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 
 //! Config for TCP sender and receiver
 class TCPConfig
 {
 public:
   static constexpr size_t DEFAULT_CAPACITY = 64000; //!< Default capacity
-  static constexpr size_t MAX_PAYLOAD_SIZE = 1000;  //!< Conservative max payload size for real Internet
+  static constexpr size_t MAX_PAYLOAD_SIZE = 1000;  //!< Conservative max payload size (default MSS)
   static constexpr uint16_t TIMEOUT_DFLT = 1000;    //!< Default re-transmit timeout is 1 second
   static constexpr unsigned MAX_RETX_ATTEMPTS = 8;  //!< Maximum re-transmit attempts before giving up
+  static constexpr uint64_t MIN_RTO_DFLT = 200;     //!< Default lower bound on an adaptive RTO (as in Linux)
+  static constexpr uint64_t MAX_RTO_DFLT = 60000;   //!< Default upper bound on an adaptive RTO (RFC 6298)
+  static constexpr uint64_t PACING_BURST_SEGMENTS = 2; //!< Most full segments a paced sender sends back to back
+  static constexpr uint64_t HOLD_TIMEOUT_DFLT = 200; //!< Default longest wait for a small segment (as TCP_CORK)
+  static constexpr uint8_t MAX_WINDOW_SHIFT = 14;    //!< Largest window scale shift (RFC 7323)
+
+  //! Congestion control for the TCPSender (None: limited only by the receiver's window)
+  enum class CongestionAlgorithm : uint8_t
+  {
+    None,
+    NewReno,
+    Cubic
+  };
 
   uint16_t rt_timeout = TIMEOUT_DFLT;      //!< Initial value of the retransmission timeout, in milliseconds
   size_t recv_capacity = DEFAULT_CAPACITY; //!< Receive capacity, in bytes
   size_t send_capacity = DEFAULT_CAPACITY; //!< Sender capacity, in bytes
   Wrap32 isn { 137 };                      //!< Default initial sequence number
+  CongestionAlgorithm congestion_control = CongestionAlgorithm::None; //!< Congestion control algorithm
+
+  bool adaptive_rto = false;           //!< Derive the RTO from measured RTTs (RFC 6298), starting at rt_timeout
+  uint64_t min_rto_ms = MIN_RTO_DFLT; //!< Lower bound on the adaptive RTO, in milliseconds
+  uint64_t max_rto_ms = MAX_RTO_DFLT; //!< Upper bound on the adaptive RTO (and its backoff), in milliseconds
+  bool fast_retransmit = false;        //!< Retransmit on three duplicate acks and recover without a timeout
+  bool sack = false; //!< Offer and use selective acknowledgments (RFC 2018); implies fast_retransmit
+  bool repacketize = false; //!< Merge small outstanding segments into full-sized ones when retransmitting
+  bool pacing = false;      //!< Spread segments out over the round trip instead of sending them in bursts
+  //! Pacing rate in bytes per second; 0 derives it from the congestion window and the smoothed RTT (which
+  //! needs congestion_control and adaptive_rto), sending unpaced until there is an RTT sample
+  uint64_t pacing_rate = 0;
+  //! Nagle's algorithm (RFC 896) with sender-side silly window avoidance (RFC 1122): hold back small segments
+  //! while data is unacknowledged, or while the receiver's window only has room for a small one
+  bool nagle = false;
+  //! Largest payload to send in one segment, and to receive (advertised to the peer in the MSS option);
+  //! the peer's MSS option can lower it. Without an option from the peer, this is what is sent.
+  size_t mss = MAX_PAYLOAD_SIZE;
+  //! Packetization-layer path MTU discovery (RFC 4821): start sending at MAX_PAYLOAD_SIZE (or mss, if smaller)
+  //! and probe for the largest size up to mss that the path delivers
+  bool mtu_probing = false;
+  uint64_t hold_timeout_ms = HOLD_TIMEOUT_DFLT; //!< Send small segments held back (by nagle or cork) after this
+  //! Offer window scaling (RFC 7323) so that a recv_capacity beyond 65,535 bytes can be advertised; it is used
+  //! only if the peer's SYN offers it too
+  bool window_scaling = false;
+
+  //! The shift that window scaling applies to the windows this side advertises: the least that fits
+  //! recv_capacity in the 16-bit window field
+  uint8_t window_shift() const
+  {
+    uint8_t shift = 0;
+    while ( shift < MAX_WINDOW_SHIFT and ( recv_capacity >> shift ) > UINT16_MAX ) {
+      shift++;
+    }
+    return shift;
+  }
+
+  //! Memory shared with other connections (optional); both streams (the outbound one including the bytes
+  //! waiting to be acknowledged) and the Reassembler are charged against it
+  std::shared_ptr<MemoryBudget> memory_budget {};
 };
 
 //! Config for classes derived from FdAdapter
@@ -53,6 +53,10 @@ public:
   void set_reuseaddr() = delete;
   //!@}
 
+  //! Like TCP_CORK: only send full-sized segments until uncorked (or for at most TCPConfig::hold_timeout_ms).
+  //! Takes effect in the TCPPeer thread within one tick; uncorking sends whatever was held back.
+  void set_corked( bool corked ) { _corked.store( corked ); }
+
   // Return peer address from underlying datagram adapter
   const Address& peer_address() const { return _datagram_adapter.config().destination; }
 
@@ -87,6 +91,11 @@ private:
 
   std::atomic_bool _abort { false }; //!< Flag used by the owner to force the TCPPeer thread to shut down
 
+  std::atomic_bool _corked { false }; //!< Set by the owner, applied to the TCPPeer by the TCPPeer thread
+
+  //! Cork or uncork the TCPPeer to match _corked
+  void _update_cork();
+
   bool _inbound_shutdown { false }; //!< Has TCPMinnowSocket shut down the incoming data to the owner?
 
   bool _outbound_shutdown { false }; //!< Has the owner shut down the outbound data to the TCP connection?
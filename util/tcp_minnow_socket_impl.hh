@@ -2,6 +2,7 @@
 
 #include "exception.hh"
 
+#include <algorithm>
 #include <cstddef>
 #include <exception>
 #include <iostream>
@@ -25,7 +26,10 @@ void TCPMinnowSocket<AdaptT>::_tcp_loop( const std::function<bool()>& condition
 {
   auto base_time = timestamp_ms();
   while ( condition() ) {
-    auto ret = _eventloop.wait_next_event( TCP_TICK_MS );
+    // Wake up early if paced segments are due before the next regular tick.
+    const auto next_send = _tcp.has_value() ? _tcp.value().ms_until_next_send() : std::nullopt;
+    const auto timeout_ms = std::min<uint64_t>( TCP_TICK_MS, next_send.value_or( TCP_TICK_MS ) );
+    auto ret = _eventloop.wait_next_event( static_cast<int>( timeout_ms ) );
     if ( ret == EventLoop::Result::Exit or _abort ) {
       break;
     }
@@ -35,6 +39,7 @@ void TCPMinnowSocket<AdaptT>::_tcp_loop( const std::function<bool()>& condition
     }
 
     if ( _tcp.value().active() ) {
+      _update_cork();
       const auto next_time = timestamp_ms();
       _tcp.value().tick( next_time - base_time, [&]( const auto& x ) { _datagram_adapter.write( x ); } );
       _datagram_adapter.tick( next_time - base_time );
@@ -43,6 +48,20 @@ void TCPMinnowSocket<AdaptT>::_tcp_loop( const std::function<bool()>& condition
   }
 }
 
+template<TCPDatagramAdapter AdaptT>
+void TCPMinnowSocket<AdaptT>::_update_cork()
+{
+  const bool corked = _corked.load();
+  if ( corked == _tcp->corked() ) {
+    return;
+  }
+  if ( corked ) {
+    _tcp->cork();
+  } else {
+    _tcp->uncork( [&]( const auto& x ) { _datagram_adapter.write( x ); } );
+  }
+}
+
 //! \param[in] data_socket_pair is a pair of connected AF_UNIX SOCK_STREAM sockets
 //! \param[in] datagram_interface is the interface for reading and writing datagrams
 template<TCPDatagramAdapter AdaptT>
@@ -60,6 +79,10 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
 {
   _tcp.emplace( config );
 
+  // Only wake up to read from the application once a full payload fits in the outbound stream.
+  _tcp->outbound_writer().set_watermarks(
+    config.send_capacity - std::min( config.send_capacity, config.mss ), 1 );
+
   // Set up the event loop
 
   // There are three events to handle:
@@ -99,10 +122,9 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
     _thread_data,
     Direction::In,
     [&] {
-      std::string data;
-      data.resize( _tcp->outbound_writer().available_capacity() );
-      _thread_data.read( data );
-      _tcp->outbound_writer().push( move( data ) );
+      _update_cork();
+      Writer& outbound = _tcp->outbound_writer();
+      outbound.commit( _thread_data.read( outbound.reserve( outbound.available_capacity() ) ) );
 
       if ( _thread_data.eof() ) {
         _tcp->outbound_writer().close();
@@ -119,7 +141,7 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
     },
     [&] {
       return ( _tcp->active() ) and ( not _outbound_shutdown )
-             and ( _tcp->outbound_writer().available_capacity() > 0 );
+             and _tcp->outbound_writer().writable();
     },
     [&] {
       _tcp->outbound_writer().close();
@@ -141,8 +163,7 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
       // the pipe, handling the possibility of a partial
       // write (i.e., only pop what was actually written).
       if ( inbound.bytes_buffered() ) {
-        const std::string_view buffer = inbound.peek();
-        const auto bytes_written = _thread_data.write( buffer );
+        const auto bytes_written = _thread_data.write( inbound.peek_iov() );
         inbound.pop( bytes_written );
       }
 
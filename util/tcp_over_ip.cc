@@ -85,12 +85,12 @@ InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip( const TCPMessage& msg )
   InternetDatagram ip_dgram;
   ip_dgram.header.src = config().source.ipv4_numeric();
   ip_dgram.header.dst = config().destination.ipv4_numeric();
-  ip_dgram.header.len = ip_dgram.header.hlen * 4 + 20 /* tcp header len */ + payload_size;
+  ip_dgram.header.len = ip_dgram.header.hlen * 4 + seg.header_length() + payload_size;
 
   // set payload, calculating TCP checksum using information from IP header
   seg.compute_checksum( ip_dgram.header.pseudo_checksum() );
   ip_dgram.header.compute_checksum();
-  ip_dgram.payload = serialize( seg );
+  ip_dgram.payload = serialize_pooled( seg ); // the caller releases it
 
   return ip_dgram;
 }
@@ -12,5 +12,7 @@ class TCPOverIPv4Adapter : public FdAdapterBase
 public:
   std::optional<TCPMessage> unwrap_tcp_in_ip( InternetDatagram ip_dgram );
 
+  //! The datagram's payload refers to `msg`'s payload bytes, which must outlive it. Its header bytes come from
+  //! ChunkPool::local(): release the payload there once it has been written.
   InternetDatagram wrap_tcp_in_ip( const TCPMessage& msg );
 };
@@ -7,6 +7,7 @@
 #include "tcp_sender.hh"
 #include "tcp_sender_message.hh"
 
+#include <algorithm>
 #include <functional>
 #include <optional>
 
@@ -18,7 +19,11 @@ class TCPPeer
   }
 
 public:
-  explicit TCPPeer( const TCPConfig& cfg ) : cfg_( cfg ) {}
+  explicit TCPPeer( const TCPConfig& cfg ) : cfg_( cfg )
+  {
+    sender_.writer().set_memory_budget( cfg_.memory_budget );
+    receiver_.reader().set_memory_budget( cfg_.memory_budget );
+  }
 
   Writer& outbound_writer() { return sender_.writer(); }
   Reader& inbound_reader() { return receiver_.reader(); }
@@ -35,6 +40,14 @@ public:
   }
   bool has_ackno() const { return receiver_.send().ackno.has_value(); }
 
+  /* Hold back partial segments (like TCP_CORK) until uncork(), or for at most TCPConfig::hold_timeout_ms */
+  void cork() { sender_.cork(); }
+  void uncork( const TransmitFunction& transmit ) { sender_.uncork( make_send( transmit ) ); }
+  bool corked() const { return sender_.corked(); }
+
+  /* How long until tick() has paced segments to send (none if the sender isn't holding any back) */
+  std::optional<uint64_t> ms_until_next_send() const { return sender_.ms_until_next_send(); }
+
   /* Is the peer still active? */
   bool active() const
   {
@@ -64,11 +77,29 @@ public:
     const auto our_ackno = receiver_.send().ackno;
     need_send_ |= ( our_ackno.has_value() and msg.sender->seqno + 1 == our_ackno.value() );
 
+    // The peer's SYN says how big a segment it can receive.
+    if ( msg.sender->SYN and msg.sender->MSS ) {
+      sender_.set_peer_mss( msg.sender->MSS );
+    }
+
+    // The peer's SYN says whether it scales the windows it advertises, and by how much (at most 14).
+    // A SYN-ACK may only offer window scaling if the SYN it answers did.
+    if ( msg.sender->SYN and msg.sender->window_scale and not peer_window_shift_ ) {
+      peer_window_shift_ = std::min( *msg.sender->window_scale, TCPConfig::MAX_WINDOW_SHIFT );
+    } else if ( msg.sender->SYN and not msg.sender->window_scale ) {
+      sender_.decline_window_scale();
+    }
+    const bool scaled = window_scaling() and not msg.sender->SYN;
+
     // Give incoming TCPSenderMessage to receiver.
     receiver_.receive( std::move( msg.sender ) );
 
-    // Give incoming TCPReceiverMessage to sender.
-    sender_.receive( msg.receiver );
+    // Give incoming TCPReceiverMessage to sender, with its window in bytes.
+    TCPReceiverMessage receiver_message = msg.receiver;
+    if ( scaled ) {
+      receiver_message.window_size <<= *peer_window_shift_;
+    }
+    sender_.receive( receiver_message );
 
     // Send reply if needed.
     push( transmit );
@@ -88,14 +119,21 @@ public:
 
 private:
   TCPConfig cfg_;
-  TCPSender sender_ { ByteStream { cfg_.send_capacity }, cfg_.isn, cfg_.rt_timeout };
-  TCPReceiver receiver_ { Reassembler { ByteStream { cfg_.recv_capacity } } };
+  TCPSender sender_ { ByteStream { cfg_.send_capacity }, cfg_ };
+  TCPReceiver receiver_ { Reassembler { ByteStream { cfg_.recv_capacity } }, cfg_ };
 
   bool need_send_ {};
 
+  // Window scaling (RFC 7323) is in effect once both SYNs have offered it. A SYN's window is never scaled.
+  std::optional<uint8_t> peer_window_shift_ {};
+  bool window_scaling() const { return cfg_.window_scaling and peer_window_shift_.has_value(); }
+
   void send( const TCPSenderMessage& sender_message, const TransmitFunction& transmit )
   {
-    transmit( { .sender = borrow( sender_message ), .receiver = receiver_.send() } );
+    TCPReceiverMessage receiver_message = receiver_.send();
+    const uint8_t shift = window_scaling() and not sender_message.SYN ? cfg_.window_shift() : 0;
+    receiver_message.window_size = std::min<uint32_t>( receiver_message.window_size >> shift, UINT16_MAX );
+    transmit( { .sender = borrow( sender_message ), .receiver = std::move( receiver_message ) } );
     need_send_ = false;
   }
 
@@ -2,7 +2,11 @@
 
 #include "wrapping_integers.hh"
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <optional>
+#include <span>
 
 /*
  * The TCPReceiverMessage structure contains the information sent from a TCP receiver to its sender.
@@ -13,15 +17,38 @@
  *    This is an optional field that is empty if the TCPReceiver hasn't yet received the Initial Sequence Number.
  *
  * 2) The window size. This is the number of sequence numbers that the TCP receiver is interested
- *    to receive, starting from the ackno if present. The maximum value is 65,535 (UINT16_MAX from
- *    the <cstdint> header).
+ *    to receive, starting from the ackno if present. The header's window field is 16 bits: past 65,535
+ *    (UINT16_MAX from the <cstdint> header), the window can only be sent once both SYNs offered window
+ *    scaling (RFC 7323), and the TCPPeer then sends it in units of 2^shift bytes.
  *
  * 3) The RST (reset) flag. If set, the stream has suffered an error and the connection should be aborted.
+ *
+ * 4) Selective acknowledgments (RFC 2018): up to four blocks of sequence numbers beyond the ackno that the
+ *    receiver holds, the block containing the most recently received data first. Only sent once the
+ *    peer's SYN said SACK_permitted.
  */
 
+struct SACKBlock
+{
+  Wrap32 begin { 0 }; // first sequence number in the block
+  Wrap32 end { 0 };   // sequence number just past the block
+};
+
 struct TCPReceiverMessage
 {
   std::optional<Wrap32> ackno {};
-  uint16_t window_size {};
+  uint32_t window_size {};
   bool RST {};
+
+  static constexpr size_t MAX_SACK_BLOCKS = 4;
+  std::array<SACKBlock, MAX_SACK_BLOCKS> sack {};
+  uint8_t sack_count {};
+
+  std::span<const SACKBlock> sack_blocks() const { return { sack.data(), sack_count }; }
+  void add_sack_block( SACKBlock block )
+  {
+    if ( sack_count < MAX_SACK_BLOCKS ) {
+      sack.at( sack_count++ ) = block;
+    }
+  }
 };
@@ -1,14 +1,139 @@
 #include "tcp_segment.hh"
 #include "checksum.hh"
+#include "chunk_pool.hh"
 #include "helpers.hh"
 #include "wrapping_integers.hh"
 
+#include <array>
 #include <sstream>
 
 using namespace std;
 
 static_assert( !( TCPSegment::HEADER_LENGTH & 0x03 ) ); // header length must be divisible by 4
 
+class Wrap32Serializable : public Wrap32
+{
+public:
+  uint32_t raw_value() const { return raw_value_; }
+};
+
+namespace {
+// Option kinds (https://www.iana.org/assignments/tcp-parameters)
+constexpr uint8_t kOptionEnd = 0;
+constexpr uint8_t kOptionNop = 1;
+constexpr uint8_t kOptionMSS = 2;
+constexpr uint8_t kOptionWindowScale = 3;
+constexpr uint8_t kOptionSACKPermitted = 4;
+constexpr uint8_t kOptionSACK = 5;
+
+// The options for a message, padded with NOPs to a multiple of four bytes
+struct OptionBytes
+{
+  array<uint8_t, TCPSegment::MAX_OPTIONS_LENGTH> bytes {};
+  uint8_t size {};
+
+  void push( uint8_t byte ) { bytes.at( size++ ) = byte; }
+  void push( uint32_t word )
+  {
+    for ( int shift = 24; shift >= 0; shift -= 8 ) {
+      push( static_cast<uint8_t>( word >> shift ) );
+    }
+  }
+  uint8_t room() const { return TCPSegment::MAX_OPTIONS_LENGTH - size; }
+};
+
+OptionBytes make_options( const TCPMessage& message )
+{
+  OptionBytes options;
+  if ( message.sender->SYN and message.sender->MSS ) {
+    options.push( kOptionMSS );
+    options.push( uint8_t { 4 } );
+    options.push( static_cast<uint8_t>( message.sender->MSS >> 8 ) );
+    options.push( static_cast<uint8_t>( message.sender->MSS ) );
+  }
+  if ( message.sender->SYN and message.sender->window_scale ) {
+    options.push( kOptionNop );
+    options.push( kOptionWindowScale );
+    options.push( uint8_t { 3 } );
+    options.push( *message.sender->window_scale );
+  }
+  if ( message.sender->SYN and message.sender->SACK_permitted ) {
+    options.push( kOptionNop );
+    options.push( kOptionNop );
+    options.push( kOptionSACKPermitted );
+    options.push( uint8_t { 2 } );
+  }
+
+  const auto blocks = message.receiver->sack_blocks();
+  const size_t count = min<size_t>( blocks.size(), ( options.room() - 4 ) / 8 );
+  if ( count ) {
+    options.push( kOptionNop );
+    options.push( kOptionNop );
+    options.push( kOptionSACK );
+    options.push( static_cast<uint8_t>( 2 + 8 * count ) );
+    for ( const auto& block : blocks.first( count ) ) {
+      options.push( Wrap32Serializable { block.begin }.raw_value() );
+      options.push( Wrap32Serializable { block.end }.raw_value() );
+    }
+  }
+  return options;
+}
+
+// Parse `length` bytes of options, ignoring the ones we don't understand (and anything malformed).
+void parse_options( Parser& parser, uint64_t length, TCPMessage& message )
+{
+  while ( length and not parser.has_error() ) {
+    uint8_t kind {};
+    parser.integer( kind );
+    length--;
+    if ( kind == kOptionEnd ) {
+      break;
+    }
+    if ( kind == kOptionNop ) {
+      continue;
+    }
+
+    // A kind in the last byte of the options has no length byte: the next byte is already payload.
+    if ( length == 0 ) {
+      break;
+    }
+    uint8_t option_length {};
+    parser.integer( option_length );
+    length--;
+    if ( option_length < 2 or option_length - 2U > length ) {
+      break;
+    }
+    length -= option_length - 2;
+    uint64_t body = option_length - 2;
+
+    if ( kind == kOptionMSS and body == 2 ) {
+      parser.integer( message.sender->MSS );
+      body = 0;
+    } else if ( kind == kOptionWindowScale and body == 1 ) {
+      parser.integer( message.sender->window_scale.emplace() );
+      body = 0;
+    } else if ( kind == kOptionSACKPermitted and body == 0 ) {
+      message.sender->SACK_permitted = true;
+    } else if ( kind == kOptionSACK and body % 8 == 0 ) {
+      for ( ; body; body -= 8 ) {
+        uint32_t begin {};
+        uint32_t end {};
+        parser.integer( begin );
+        parser.integer( end );
+        message.receiver->add_sack_block( { Wrap32 { begin }, Wrap32 { end } } );
+      }
+    }
+    parser.remove_prefix( body );
+  }
+  parser.remove_prefix( length );
+}
+} // namespace
+
+uint8_t TCPSegment::header_length() const
+{
+  return HEADER_LENGTH + make_options( message ).size;
+}
+
 void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum )
 {
   /* verify checksum */
@@ -44,52 +169,53 @@ void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum
   message.sender->SYN = octet & 0b0000'0010;
   message.sender->FIN = octet & 0b0000'0001;
 
-  parser.integer( message.receiver->window_size );
+  parser.integer( raw16 );
+  message.receiver->window_size = raw16; // scaled up by the TCPPeer, if window scaling is in effect
   parser.integer( udinfo.cksum );
   parser.integer( raw16 ); // urgent pointer
 
-  // skip any options or anything extra in the header
   if ( data_offset < ( HEADER_LENGTH >> 2 ) ) {
     parser.set_error();
     return;
   }
-  parser.remove_prefix( ( data_offset * 4 ) - HEADER_LENGTH );
+  parse_options( parser, ( data_offset * 4 ) - HEADER_LENGTH, message );
 
   parser.concatenate_all_remaining( message.sender->payload );
 }
 
-class Wrap32Serializable : public Wrap32
-{
-public:
-  uint32_t raw_value() const { return raw_value_; }
-};
-
 void TCPSegment::serialize( Serializer& serializer ) const
 {
   serializer.integer( udinfo.src_port );
   serializer.integer( udinfo.dst_port );
   serializer.integer( Wrap32Serializable { message.sender->seqno }.raw_value() );
   serializer.integer( Wrap32Serializable { message.receiver->ackno.value_or( Wrap32 { 0 } ) }.raw_value() );
-  serializer.integer( uint8_t { ( HEADER_LENGTH >> 2 ) << 4 } ); // data offset
+  const OptionBytes options = make_options( message );
+  serializer.integer( static_cast<uint8_t>( ( ( HEADER_LENGTH + options.size ) >> 2 ) << 4 ) ); // data offset
   const bool reset = message.sender->RST or message.receiver->RST;
   const uint8_t flags = ( message.receiver->ackno.has_value() ? 0b0001'0000U : 0 ) | ( reset ? 0b0000'0100U : 0 )
                         | ( message.sender->SYN ? 0b0000'0010U : 0 ) | ( message.sender->FIN ? 0b0000'0001U : 0 );
   serializer.integer( flags );
-  serializer.integer( message.receiver->window_size );
+  serializer.integer( static_cast<uint16_t>( min<uint32_t>( message.receiver->window_size, UINT16_MAX ) ) );
   serializer.integer( udinfo.cksum );
   serializer.integer( uint16_t { 0 } ); // urgent pointer
-  serializer.buffer( message.sender->payload );
+  for ( const uint8_t byte : span { options.bytes }.first( options.size ) ) {
+    serializer.integer( byte );
+  }
+  serializer.buffer( Ref<string>::borrow( message.sender->payload ) ); // sent as is, without a copy
 }
 
 void TCPSegment::compute_checksum( uint32_t datagram_layer_pseudo_checksum )
 {
   udinfo.cksum = 0;
-  Serializer s;
+  Serializer s { ChunkPool::local() };
   serialize( s );
 
+  auto buffers = s.finish();
+
   InternetChecksum check { datagram_layer_pseudo_checksum };
-  check.add( s.finish() );
+  check.add( buffers );
   udinfo.cksum = check.value();
+  ChunkPool::local().release( move( buffers ) );
 }
 
 string TCPSegment::to_string() const
@@ -106,6 +232,15 @@ string TCPSegment::to_string() const
   if ( message.sender->FIN ) {
     ss << " +FIN";
   }
+  if ( message.sender->MSS ) {
+    ss << " MSS=" << message.sender->MSS;
+  }
+  if ( message.sender->window_scale ) {
+    ss << " WS=" << static_cast<unsigned>( *message.sender->window_scale );
+  }
+  if ( message.sender->SACK_permitted ) {
+    ss << " +SACK_PERM";
+  }
   if ( message.sender->RST or message.receiver->RST ) {
     ss << " +RST";
   }
@@ -114,6 +249,10 @@ string TCPSegment::to_string() const
     ss << " ACK<" << Wrap32Serializable { *ackno }.raw_value() << ">";
   }
   ss << " winsize=" << message.receiver->window_size;
+  for ( const auto& block : message.receiver->sack_blocks() ) {
+    ss << " SACK<" << Wrap32Serializable { block.begin }.raw_value() << "-"
+       << Wrap32Serializable { block.end }.raw_value() << ">";
+  }
   ss << " src=" << udinfo.src_port << " dst=" << udinfo.dst_port;
   return ss.str();
 }
@@ -23,11 +23,18 @@ struct TCPSegment
   UserDatagramInfo udinfo {};
 
   void parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum );
+
+  // The serialized segment borrows the payload rather than copying it: keep the message alive (and
+  // unchanged) for as long as the output is in use.
   void serialize( Serializer& serializer ) const;
 
   void compute_checksum( uint32_t datagram_layer_pseudo_checksum );
 
-  static constexpr uint8_t HEADER_LENGTH = 20; // TCP header length, not including options
+  static constexpr uint8_t HEADER_LENGTH = 20;      // TCP header length, not including options
+  static constexpr uint8_t MAX_OPTIONS_LENGTH = 40; // what the 4-bit data offset leaves room for
+
+  // TCP header length including the options that serialize() will write
+  uint8_t header_length() const;
 
   // Return a string containing a summary in human-readable format
   std::string to_string() const;
@@ -2,6 +2,8 @@
 
 #include "wrapping_integers.hh"
 
+#include <cstdint>
+#include <optional>
 #include <string>
 
 /*
@@ -20,6 +22,11 @@
  * 4) The FIN flag. If set, the payload represents the ending of the byte stream.
  *
  * 5) The RST (reset) flag. If set, the stream has suffered an error and the connection should be aborted.
+ *
+ * 6) Options that a SYN can carry to describe what the sender's side of the connection supports:
+ *    SACK_permitted says that it understands selective acknowledgments (RFC 2018), and MSS (if not zero) is
+ *    the largest payload it can receive in one segment. window_scale (RFC 7323), if present, is the shift
+ *    that the sender's side will apply to the windows it advertises, once both SYNs have offered it.
  */
 
 struct TCPSenderMessage
@@ -32,6 +39,10 @@ struct TCPSenderMessage
 
   bool RST {};
 
+  bool SACK_permitted {};
+  uint16_t MSS {};
+  std::optional<uint8_t> window_scale {};
+
   // How many sequence numbers does this segment use?
   size_t sequence_length() const { return SYN + payload.size() + FIN; }
 };
@@ -1,6 +1,9 @@
 #include "tuntap_adapter.hh"
+#include "chunk_pool.hh"
 #include "helpers.hh"
 
+#include <span>
+
 using namespace std;
 
 optional<TCPMessage> TCPOverIPv4OverTunFdAdapter::read()
@@ -19,7 +22,13 @@ optional<TCPMessage> TCPOverIPv4OverTunFdAdapter::read()
 
 void TCPOverIPv4OverTunFdAdapter::write( const TCPMessage& seg )
 {
-  _tun.write( serialize( wrap_tcp_in_ip( seg ) ) );
+  // The serialized datagram borrows from `datagram` (and the payload from `seg`), so both stay alive until
+  // the writev() returns.
+  InternetDatagram datagram = wrap_tcp_in_ip( seg );
+  auto buffers = serialize_pooled( datagram );
+  _tun.write( span { buffers } );
+  ChunkPool::local().release( move( buffers ) );
+  ChunkPool::local().release( move( datagram.payload ) );
 }
 
 //! Specialize LossyFdAdapter to TCPOverIPv4OverTunFdAdapter